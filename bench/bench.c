@@ -0,0 +1,440 @@
+// бенчмарк этапов лабораторной работы, номер задаётся при сборке: -DLAB=1..4
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifndef LAB
+#define LAB 4
+#endif
+
+// main лабораторной переименовывается, остальные функции используются напрямую
+#define main lab_main
+#if LAB == 1
+#include "../lab1/prog.c"
+#elif LAB == 2
+#include "../lab2/main.c"
+#elif LAB == 3
+#include "../lab3/main.c"
+#else
+#include "../lab4/main.c"
+#endif
+#undef main
+
+#include "gen.h"
+
+#define MAX_ROWS 4096
+
+#if LAB == 1
+static const char *priority_stages[3] = {
+    "top_sort_priority_lex", "top_sort_priority_critical_bucket", "top_sort_priority_critical_heap"
+};
+#endif
+#define MAX_SIZES 16
+
+typedef struct {
+    const char *kind;
+    long long edges;
+    long long vertices;
+    const char *stage;
+    const char *status;
+    double seconds;     // лучшее время среди повторов
+    double mean;        // среднее время
+    long long ops;      // число операций этапа (для контейнеров, дерева и поиска)
+} BenchRow;
+
+BenchRow rows[MAX_ROWS];
+int row_count = 0;
+int bench_storage = 2; // тип хранения для lab1
+int saved_stdout = -1;
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// лабораторные печатают результат в stdout, на время замеров он уходит в /dev/null
+void quiet_begin(void) {
+    fflush(stdout);
+    saved_stdout = dup(1);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, 1);
+    close(null_fd);
+}
+
+void quiet_end(void) {
+    fflush(stdout);
+    dup2(saved_stdout, 1);
+    close(saved_stdout);
+}
+
+void add_row(const char *kind, long long edges, long long vertices, const char *stage,
+             const char *status, double best, double mean, long long ops) {
+    if (row_count >= MAX_ROWS) return;
+    BenchRow *r = &rows[row_count++];
+    r->kind = kind;
+    r->edges = edges;
+    r->vertices = vertices;
+    r->stage = stage;
+    r->status = status;
+    r->seconds = best;
+    r->mean = mean;
+    r->ops = ops;
+}
+
+// учёт одного повтора: лучшее и суммарное время
+void account(double t, double *best, double *sum) {
+    if (*best < 0 || t < *best) *best = t;
+    *sum += t;
+}
+
+// текст порядка в том же виде, что строит process_and_search
+char *render_order(int *order, int count, int *len) {
+    char *text = malloc((size_t)count * 12 + 1);
+    int n = 0;
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) text[n++] = ' ';
+        n += sprintf(text + n, "%d", order[i]);
+    }
+    text[n] = '\0';
+    *len = n;
+    return text;
+}
+
+// один прогон всех этапов для графа заданного вида и размера
+void bench_case(GenKind kind, long long edges, unsigned long long seed, int repeats,
+                long long matrix_limit, const char *tmp_dir) {
+    const char *kname = gen_kind_names[kind];
+    char path[512];
+    snprintf(path, sizeof(path), "%s/bench_%s_%lld.txt", tmp_dir, kname, edges);
+
+    double t0 = now_sec();
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror("Ошибка при создании файла графа");
+        return;
+    }
+    long long n = gen_write(f, kind, edges, seed);
+    fclose(f);
+    add_row(kname, edges, n, "generate", "ok", now_sec() - t0, now_sec() - t0, edges);
+
+    // разбор файла
+    double best = -1, sum = 0;
+    Edge *parsed = NULL;
+    int capacity = 0;
+    int edge_count = 0;
+    for (int r = 0; r < repeats; ++r) {
+        quiet_begin();
+        t0 = now_sec();
+#if LAB == 1
+        edge_count = read_edges(path, &parsed, &capacity, NULL);
+#else
+        edge_count = read_edges(path, &parsed, &capacity);
+#endif
+        account(now_sec() - t0, &best, &sum);
+        quiet_end();
+    }
+    add_row(kname, edges, n, "parse", edge_count >= 0 ? "ok" : "error", best, sum / repeats, edge_count);
+    unlink(path);
+    if (edge_count < 0) {
+        free(parsed);
+        return;
+    }
+
+    int vertex_count = find_vertex_count(parsed, edge_count);
+#if LAB == 4
+    int *order = NULL;
+    int order_len = 0;
+#endif
+
+    // построение матрицы и сортировки: только если матрица помещается в лимит
+    long long matrix_bytes = (long long)vertex_count * vertex_count * (long long)sizeof(int);
+#if LAB == 1
+    if (bench_storage == STORAGE_BITSET)
+        matrix_bytes = (long long)vertex_count * ((vertex_count + 63) / 64) * 8;
+    else if (bench_storage == STORAGE_SPARSE)
+        matrix_bytes = (long long)(vertex_count + 1 + edge_count) * sizeof(int);
+    else if (bench_storage == STORAGE_VARINT)
+        matrix_bytes = (long long)(vertex_count + edge_count) * 5;   // не больше 5 байт на varint
+#endif
+    if (matrix_bytes > matrix_limit) {
+        add_row(kname, edges, vertex_count, "build", "skipped", 0, 0, 0);
+        add_row(kname, edges, vertex_count, "top_sort_kahn", "skipped", 0, 0, 0);
+        add_row(kname, edges, vertex_count, "top_sort_tarjan", "skipped", 0, 0, 0);
+#if LAB == 1
+        for (int m = 0; m < 3; ++m)
+            add_row(kname, edges, vertex_count, priority_stages[m], "skipped", 0, 0, 0);
+#endif
+    } else {
+#if LAB == 1
+        Workspace ws = {0};
+        ws.edges = parsed;
+        Graph g;
+#else
+        int **adj = NULL;
+#endif
+        best = -1;
+        sum = 0;
+        for (int r = 0; r < repeats; ++r) {
+#if LAB == 1
+            t0 = now_sec();
+            build_graph(&g, &ws, edge_count, vertex_count, bench_storage);
+#else
+            if (adj)
+                free_adj(adj, vertex_count);
+            t0 = now_sec();
+            adj = build_adj(parsed, edge_count, vertex_count);
+#endif
+            account(now_sec() - t0, &best, &sum);
+        }
+        add_row(kname, edges, vertex_count, "build", "ok", best, sum / repeats, edge_count);
+
+        const char *stages[2] = { "top_sort_kahn", "top_sort_tarjan" };
+        for (int m = 0; m < 2; ++m) {
+            best = -1;
+            sum = 0;
+            for (int r = 0; r < repeats; ++r) {
+                quiet_begin();
+                t0 = now_sec();
+#if LAB == 4
+                int *res = m == 0 ? top_sort_kahn(adj, vertex_count) : top_sort_tarjan(adj, vertex_count);
+                account(now_sec() - t0, &best, &sum);
+                if (res && !order) {
+                    order = res;
+                    order_len = vertex_count;
+                } else {
+                    free(res);
+                }
+#elif LAB == 1
+                if (m == 0)
+                    top_sort_kahn(&g);
+                else
+                    top_sort_tarjan(&g);
+                account(now_sec() - t0, &best, &sum);
+#else
+                if (m == 0)
+                    top_sort_kahn(adj, vertex_count);
+                else
+                    top_sort_tarjan(adj, vertex_count);
+                account(now_sec() - t0, &best, &sum);
+#endif
+                quiet_end();
+            }
+            add_row(kname, edges, vertex_count, stages[m], "ok", best, sum / repeats, vertex_count);
+        }
+
+#if LAB == 1
+        // Кан с приоритетом против FIFO: наименьший номер (куча), критический
+        // путь через корзины (если разброс мал) и через кучу
+        int *prio = critical_path_priorities(&g);
+        for (int m = 0; m < 3; ++m) {
+            use_bucket_queue = m == 1;
+            best = -1;
+            sum = 0;
+            for (int r = 0; r < repeats; ++r) {
+                quiet_begin();
+                t0 = now_sec();
+                top_sort_priority(&g, m == 0 ? NULL : prio);
+                account(now_sec() - t0, &best, &sum);
+                quiet_end();
+            }
+            add_row(kname, edges, vertex_count, priority_stages[m], "ok", best, sum / repeats, vertex_count);
+        }
+        use_bucket_queue = 1;
+        free(prio);
+
+        ws.edges = NULL; // массив рёбер принадлежит бенчмарку
+        free_workspace(&ws);
+#else
+        free_adj(adj, vertex_count);
+#endif
+    }
+    free(parsed);
+
+#if LAB == 2 || LAB == 3
+    // операции контейнера: вершины проходят через очередь, как в методе Кана
+    best = -1;
+    sum = 0;
+    for (int r = 0; r < repeats; ++r) {
+        long long check = 0;
+        t0 = now_sec();
+#if LAB == 2
+        Deque *dq = createDeque();
+        for (int i = 0; i < vertex_count; ++i) {
+            if (i & 1) pushFront(dq, i);
+            else pushBack(dq, i);
+        }
+        while (!isEmpty(dq)) {
+            check += front(dq);
+            popFront(dq);
+        }
+        clearDeque(dq);
+#else
+        Queue q;
+        init_queue(&q);
+        for (int i = 0; i < vertex_count; ++i)
+            enqueue(&q, i);
+        while (!is_empty(&q))
+            check += dequeue(&q);
+#endif
+        account(now_sec() - t0, &best, &sum);
+        if (check < 0) printf("%lld\n", check); // не даём компилятору выбросить цикл
+    }
+    add_row(kname, edges, vertex_count, LAB == 2 ? "deque_ops" : "queue_ops", "ok",
+            best, sum / repeats, 2LL * vertex_count);
+#endif
+
+#if LAB == 4
+    // без матрицы порядок берём как перестановку вершин
+    if (!order) {
+        unsigned long long state = seed;
+        order = gen_permutation(vertex_count, &state);
+        order_len = vertex_count;
+    }
+
+    best = -1;
+    sum = 0;
+    for (int r = 0; r < repeats; ++r) {
+        RBTree tree;
+        init_rbtree(&tree);
+        t0 = now_sec();
+        for (int i = 0; i < order_len; ++i)
+            insert_rbtree(&tree, order[i]);
+        account(now_sec() - t0, &best, &sum);
+        // узлы дерева в лабораторной не освобождаются, в бенчмарке тоже
+    }
+    add_row(kname, edges, vertex_count, "rbtree_insert", "ok", best, sum / repeats, order_len);
+
+    // поиск последних трёх чисел порядка: совпадение в конце текста
+    int text_len = 0;
+    char *text = render_order(order, order_len, &text_len);
+    int tail = order_len >= 3 ? 3 : order_len;
+    int pat_len = 0;
+    char *pattern = render_order(order + order_len - tail, tail, &pat_len);
+    best = -1;
+    sum = 0;
+    for (int r = 0; r < repeats; ++r) {
+        t0 = now_sec();
+        int pos = boyer_moore_search(text, pattern, NULL);
+        account(now_sec() - t0, &best, &sum);
+        if (pos < 0) printf("Шаблон не найден\n");
+    }
+    add_row(kname, edges, vertex_count, "boyer_moore_search", "ok", best, sum / repeats, text_len);
+    free(pattern);
+    free(text);
+    free(order);
+#endif
+}
+
+void print_csv(FILE *f, const char *tag) {
+    fprintf(f, "tag,lab,kind,edges,vertices,stage,status,best_sec,mean_sec,ops\n");
+    for (int i = 0; i < row_count; ++i) {
+        BenchRow *r = &rows[i];
+        fprintf(f, "%s,%d,%s,%lld,%lld,%s,%s,%.9f,%.9f,%lld\n", tag, LAB, r->kind, r->edges,
+                r->vertices, r->stage, r->status, r->seconds, r->mean, r->ops);
+    }
+}
+
+void print_json(FILE *f, const char *tag) {
+    fprintf(f, "[\n");
+    for (int i = 0; i < row_count; ++i) {
+        BenchRow *r = &rows[i];
+        fprintf(f, "  {\"tag\": \"%s\", \"lab\": %d, \"kind\": \"%s\", \"edges\": %lld, "
+                "\"vertices\": %lld, \"stage\": \"%s\", \"status\": \"%s\", "
+                "\"best_sec\": %.9f, \"mean_sec\": %.9f, \"ops\": %lld}%s\n",
+                tag, LAB, r->kind, r->edges, r->vertices, r->stage, r->status,
+                r->seconds, r->mean, r->ops, i + 1 < row_count ? "," : "");
+    }
+    fprintf(f, "]\n");
+}
+
+void bench_usage(const char *name) {
+    fprintf(stderr,
+            "Использование: %s [-k виды] [-s размеры] [-r повторы] [-f csv|json] [-o файл]\n"
+            "  -k random,chain,layered,cyclic  виды графов (по умолчанию все)\n"
+            "  -s 1e3,1e4,1e5                   числа рёбер (до 1e8)\n"
+            "  -r 3                             число повторов каждого этапа\n"
+            "  -M 512                           лимит памяти матрицы смежности, МБ\n"
+            "  -A 2                             тип хранения для lab1 (2 - динамический, 3 - битовый, 4 - CSR, 5 - varint)\n"
+            "  -S 1                             seed генератора\n"
+            "  -d /tmp                          каталог для временных файлов\n"
+            "  -t метка                         метка прогона (версия, коммит)\n",
+            name);
+}
+
+int main(int argc, char **argv) {
+    int kinds[GEN_KIND_COUNT] = { 1, 1, 1, 1 };
+    long long sizes[MAX_SIZES] = { 1000, 10000, 100000 };
+    int size_count = 3;
+    int repeats = 3;
+    long long matrix_limit = 512LL << 20;
+    unsigned long long seed = 1;
+    const char *format = "csv";
+    const char *out_path = NULL;
+    const char *tmp_dir = "/tmp";
+    const char *tag = "dev";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:s:r:M:A:S:f:o:d:t:h")) != -1) {
+        char *list, *tok;
+        switch (opt) {
+        case 'k':
+            memset(kinds, 0, sizeof(kinds));
+            list = strdup(optarg);
+            for (tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+                int k = gen_kind_parse(tok);
+                if (k < 0) {
+                    fprintf(stderr, "Неизвестный вид графа: %s\n", tok);
+                    return 1;
+                }
+                kinds[k] = 1;
+            }
+            free(list);
+            break;
+        case 's':
+            size_count = 0;
+            list = strdup(optarg);
+            for (tok = strtok(list, ","); tok && size_count < MAX_SIZES; tok = strtok(NULL, ","))
+                sizes[size_count++] = (long long)strtod(tok, NULL);
+            free(list);
+            break;
+        case 'r': repeats = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'M': matrix_limit = atoll(optarg) << 20; break;
+        case 'A': bench_storage = atoi(optarg); break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        case 'f': format = optarg; break;
+        case 'o': out_path = optarg; break;
+        case 'd': tmp_dir = optarg; break;
+        case 't': tag = optarg; break;
+        default:
+            bench_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    for (int k = 0; k < GEN_KIND_COUNT; ++k) {
+        if (!kinds[k]) continue;
+        for (int s = 0; s < size_count; ++s) {
+            fprintf(stderr, "lab%d: %s, %lld рёбер\n", LAB, gen_kind_names[k], sizes[s]);
+            bench_case((GenKind)k, sizes[s], seed, repeats, matrix_limit, tmp_dir);
+        }
+    }
+
+    FILE *f = out_path ? fopen(out_path, "w") : stdout;
+    if (!f) {
+        perror("Ошибка при открытии файла результатов");
+        return 1;
+    }
+    if (strcmp(format, "json") == 0)
+        print_json(f, tag);
+    else
+        print_csv(f, tag);
+    if (f != stdout)
+        fclose(f);
+    return 0;
+}
@@ -0,0 +1,125 @@
+// бенчмарк деревьев lab4: красно-чёрное против B+-дерева с узлами в строку кэша
+// на вставках, поиске и обходе по возрастанию
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#define main lab_main
+#include "../lab4/main.c"
+#undef main
+
+#include "gen.h"
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef enum { KEYS_RANDOM, KEYS_SORTED, KEYS_KIND_COUNT } KeysKind;
+
+static const char *keys_kind_names[KEYS_KIND_COUNT] = { "random", "sorted" };
+
+void report(const char *keys, int n, const char *tree, const char *workload, long long ops,
+            double seconds, long long bytes, long long hits, int mismatches) {
+    printf("%s,%d,%s,%s,%lld,%.6f,%.1f,%lld,%lld,%d\n", keys, n, tree, workload, ops, seconds,
+           seconds * 1e9 / ops, bytes, hits, mismatches);
+}
+
+int main(int argc, char **argv) {
+    int n = 1000000;
+    int queries = 1000000;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:q:S:h")) != -1) {
+        switch (opt) {
+        case 'n': n = (int)strtod(optarg, NULL); break;
+        case 'q': queries = (int)strtod(optarg, NULL); break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s [-n ключей] [-q поисков] [-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("keys,n,tree,workload,ops,seconds,ns_per_op,bytes,hits,mismatches\n");
+    for (int kind = 0; kind < KEYS_KIND_COUNT; ++kind) {
+        // ключи как в порядке вершин: перестановка 0..n-1 или уже отсортированные
+        unsigned long long state = seed;
+        int *keys = gen_permutation(n, &state);
+        if (kind == KEYS_SORTED)
+            for (int i = 0; i < n; ++i)
+                keys[i] = i;
+        // запросы: половина - есть в дереве, половина - нет
+        int *probe = malloc(queries * sizeof(int));
+        for (int i = 0; i < queries; ++i)
+            probe[i] = (int)gen_range(&state, 2LL * n);
+        const char *kname = keys_kind_names[kind];
+
+        // вставки
+        RBTree rb;
+        init_rbtree(&rb);
+        double t0 = now_sec();
+        for (int i = 0; i < n; ++i)
+            insert_rbtree(&rb, keys[i]);
+        double seconds = now_sec() - t0;
+        long long rb_bytes = (long long)(n + 1) * sizeof(TreeNode);
+        report(kname, n, "rbtree", "insert", n, seconds, rb_bytes, 0, 0);
+
+        BPTree bp;
+        t0 = now_sec();
+        init_bptree(&bp);
+        for (int i = 0; i < n; ++i)
+            insert_bptree(&bp, keys[i]);
+        seconds = now_sec() - t0;
+        report(kname, n, "bplus", "insert", n, seconds, bp.bytes, 0, 0);
+
+        // поиск; ответы красно-чёрного дерева служат эталоном
+        char *found = malloc(queries);
+        long long hits = 0;
+        t0 = now_sec();
+        for (int i = 0; i < queries; ++i) {
+            found[i] = search_rbtree(&rb, probe[i]) != rb.nil;
+            hits += found[i];
+        }
+        seconds = now_sec() - t0;
+        report(kname, n, "rbtree", "lookup", queries, seconds, rb_bytes, hits, 0);
+
+        int mismatches = 0;
+        hits = 0;
+        t0 = now_sec();
+        for (int i = 0; i < queries; ++i) {
+            int f = search_bptree(&bp, probe[i]);
+            hits += f;
+            mismatches += f != found[i];
+        }
+        seconds = now_sec() - t0;
+        report(kname, n, "bplus", "lookup", queries, seconds, bp.bytes, hits, mismatches);
+
+        // обход по возрастанию
+        long long *a = malloc((size_t)n * sizeof(long long));
+        long long *b = malloc((size_t)n * sizeof(long long));
+        t0 = now_sec();
+        int count = inorder_rbtree(&rb, a);
+        seconds = now_sec() - t0;
+        report(kname, n, "rbtree", "inorder", count, seconds, rb_bytes, 0, 0);
+        t0 = now_sec();
+        count = inorder_bptree(&bp, b);
+        seconds = now_sec() - t0;
+        report(kname, n, "bplus", "inorder", count, seconds, bp.bytes, 0,
+               count != n || memcmp(a, b, (size_t)n * sizeof(long long)) != 0);
+
+        free(a);
+        free(b);
+        free(found);
+        free(probe);
+        free(keys);
+        free_bptree(&bp);
+        // узлы красно-чёрного дерева в лабораторной не освобождаются, в бенчмарке тоже
+    }
+    return 0;
+}
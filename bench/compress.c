@@ -0,0 +1,116 @@
+// бенчмарк сжатого представления графа lab1: память и время сортировки
+// у CSR (sparse) и строк с разностями в varint (varint)
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#define main lab_main
+#include "../lab1/prog.c"
+#undef main
+
+#include "gen.h"
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// лучшее время из repeats запусков сортировки; Тарьян выводит порядок в out,
+// у Кана *count - число упорядоченных вершин
+double time_sort(const Graph *g, int method, int repeats, int *result, int *count) {
+    double best = -1;
+    for (int r = 0; r < repeats; ++r) {
+        double t0 = now_sec();
+        if (method == 1)
+            *count = kahn_order(g, result);
+        else
+            top_sort_tarjan(g);
+        double t = now_sec() - t0;
+        if (best < 0 || t < best) best = t;
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    long long edges = 10000000;
+    int repeats = 3;
+    const char *path = NULL;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:r:f:S:h")) != -1) {
+        switch (opt) {
+        case 's': edges = (long long)strtod(optarg, NULL); break;
+        case 'r': repeats = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'f': path = optarg; break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s [-s рёбер] [-r повторы] [-f файл] [-S seed]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    // порядок Тарьяна не нужен, только время
+    out.fd = open("/dev/null", O_WRONLY);
+
+    printf("kind,vertices,edges,storage,bytes,bytes_per_edge,ratio,build_sec,kahn_sec,"
+           "tarjan_sec,mismatches\n");
+    for (int kind = 0; kind < GEN_KIND_COUNT; ++kind) {
+        // с -f - один заданный граф
+        if (path && kind > 0)
+            break;
+        Workspace ws = {0};
+        int count;
+        if (path) {
+            count = read_edges(path, &ws.edges, &ws.edge_capacity, NULL);
+        } else {
+            FILE *f = tmpfile();
+            gen_write(f, (GenKind)kind, edges, seed);
+            rewind(f);
+            count = read_edges_stream(f, &ws.edges, &ws.edge_capacity, NULL);
+            fclose(f);
+        }
+        if (count <= 0)
+            return 1;
+        int vertex_count = find_vertex_count(ws.edges, count);
+        const char *kname = path ? "file" : gen_kind_names[kind];
+
+        int *expected = malloc(vertex_count * sizeof(int));
+        int *result = malloc(vertex_count * sizeof(int));
+        size_t sparse_bytes = 0;
+        int expected_count = 0;
+        int storages[2] = { STORAGE_SPARSE, STORAGE_VARINT };
+        for (int s = 0; s < 2; ++s) {
+            Graph g;
+            double t0 = now_sec();
+            if (build_graph(&g, &ws, count, vertex_count, storages[s]) != 0)
+                return 1;
+            double build = now_sec() - t0;
+            size_t bytes = graph_bytes(&g);
+            if (s == 0)
+                sparse_bytes = bytes;
+
+            int ordered;
+            double kahn = time_sort(&g, 1, repeats, s == 0 ? expected : result,
+                                    s == 0 ? &expected_count : &ordered);
+            double tarjan = time_sort(&g, 2, repeats, NULL, NULL);
+            // порядок Кана у CSR служит эталоном
+            int mismatches = s > 0 && (ordered != expected_count
+                             || memcmp(expected, result, ordered * sizeof(int)) != 0);
+            printf("%s,%d,%d,%s,%zu,%.2f,%.2f,%.4f,%.4f,%.4f,%d\n", kname, vertex_count, count,
+                   s == 0 ? "sparse" : "varint", bytes, (double)bytes / count,
+                   (double)sparse_bytes / bytes, build, kahn, tarjan, mismatches);
+        }
+        free(expected);
+        free(result);
+        free_workspace(&ws);
+    }
+    close(out.fd);
+    return 0;
+}
@@ -0,0 +1,397 @@
+// микробенчмарк очередей метода Кана, контейнер задаётся при сборке:
+//   -DLAB=1 - массив (lab1/lab4), -DLAB=2 - дек на списке, -DLAB=3 - кольцевая очередь,
+//   -DLAB=5 - 4-арная куча и -DLAB=6 - очередь по корзинам из Кана с приоритетом lab1
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef LAB
+#define LAB 1
+#endif
+
+#define main lab_main
+#if LAB == 2
+#include "../lab2/main.c"
+#elif LAB == 3
+#include "../lab3/main.c"
+#elif LAB == 5 || LAB == 6
+#include "../lab1/prog.c"
+#endif
+#undef main
+
+#include "gen.h"
+
+// единый интерфейс над контейнерами лабораторных
+#if LAB == 2
+#define CONTAINER_NAME "deque"
+typedef struct { Deque *dq; } Container;
+void c_init(Container *c, int capacity) { (void)capacity; c->dq = createDeque(); }
+void c_push(Container *c, int v) { pushBack(c->dq, v); }
+int c_pop(Container *c) { int v = front(c->dq); popFront(c->dq); return v; }
+int c_empty(Container *c) { return isEmpty(c->dq); }
+void c_free(Container *c) { clearDeque(c->dq); }
+#elif LAB == 3
+#define CONTAINER_NAME "ring_queue"
+typedef struct { Queue q; } Container;
+void c_init(Container *c, int capacity) { (void)capacity; init_queue(&c->q); }
+void c_push(Container *c, int v) { enqueue(&c->q, v); }
+int c_pop(Container *c) { return dequeue(&c->q); }
+int c_empty(Container *c) { return is_empty(&c->q); }
+void c_free(Container *c) { while (!is_empty(&c->q)) dequeue(&c->q); }
+#elif LAB == 5
+// ключ - номер вершины, как в порядке lex
+#define CONTAINER_NAME "heap4"
+typedef struct { Heap4 h; } Container;
+void c_init(Container *c, int capacity) { heap_init(&c->h, capacity); }
+void c_push(Container *c, int v) { heap_push(&c->h, (uint64_t)v, v); }
+int c_pop(Container *c) { return heap_pop(&c->h); }
+int c_empty(Container *c) { return c->h.size == 0; }
+void c_free(Container *c) { heap_free(&c->h); }
+#elif LAB == 6
+// корзина - младшие разряды номера вершины, как небольшой целый приоритет
+#define CONTAINER_NAME "bucket_queue"
+typedef struct { BucketQueue *q; int size; } Container;
+void c_init(Container *c, int capacity) { c->q = bucket_create(capacity); c->size = 0; }
+void c_push(Container *c, int v) { bucket_push(c->q, v % BUCKET_RANGE, v); c->size++; }
+int c_pop(Container *c) { c->size--; return bucket_pop(c->q); }
+int c_empty(Container *c) { return c->size == 0; }
+void c_free(Container *c) { bucket_free(c->q); }
+#else
+// очередь на массиве, как в top_sort_kahn: каждая вершина попадает в неё один раз
+#define CONTAINER_NAME "array_queue"
+typedef struct { int *queue; int front, rear; } Container;
+void c_init(Container *c, int capacity) { c->queue = malloc(capacity * sizeof(int)); c->front = c->rear = 0; }
+void c_push(Container *c, int v) { c->queue[c->rear++] = v; }
+int c_pop(Container *c) { return c->queue[c->front++]; }
+int c_empty(Container *c) { return c->front == c->rear; }
+void c_free(Container *c) { free(c->queue); }
+#endif
+
+typedef enum { WL_FIFO, WL_STEADY, WL_KAHN, WL_COUNT } Workload;
+
+static const char *workload_names[WL_COUNT] = { "fifo", "steady", "kahn" };
+
+// граф для нагрузки kahn в виде CSR
+typedef struct {
+    int n;
+    int *offset;
+    int *target;
+} Csr;
+
+typedef struct {
+    const char *workload;
+    long long n;
+    long long ops;
+    double ops_per_sec;
+    double p50_ns;
+    double p99_ns;
+    long long peak_rss_kb;
+    long long cache_misses;  // -1, если счётчики недоступны
+    long long branch_misses;
+} Result;
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// отметка времени для замера одной операции: такты, если есть rdtsc
+static inline uint64_t tick(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+double ns_per_tick = 1.0;
+double tick_overhead = 0.0;
+
+// калибровка тактов по монотонным часам и накладных расходов самого замера
+void calibrate(void) {
+    double t0 = now_sec();
+    uint64_t c0 = tick();
+    while (now_sec() - t0 < 0.05);
+    uint64_t c1 = tick();
+    ns_per_tick = (now_sec() - t0) * 1e9 / (double)(c1 - c0);
+
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 1000; ++i) {
+        uint64_t a = tick();
+        uint64_t b = tick();
+        if (b - a < best) best = b - a;
+    }
+    tick_overhead = (double)best;
+}
+
+// ---- аппаратные счётчики ----
+
+int perf_fd[2] = { -1, -1 };
+
+int perf_open(uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void perf_begin(void) {
+    perf_fd[0] = perf_open(PERF_COUNT_HW_CACHE_MISSES);
+    perf_fd[1] = perf_open(PERF_COUNT_HW_BRANCH_MISSES);
+    for (int i = 0; i < 2; ++i) {
+        if (perf_fd[i] < 0) continue;
+        ioctl(perf_fd[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(perf_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void perf_end(long long *cache_misses, long long *branch_misses) {
+    long long *dst[2] = { cache_misses, branch_misses };
+    for (int i = 0; i < 2; ++i) {
+        long long value = -1;
+        if (perf_fd[i] >= 0) {
+            ioctl(perf_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(perf_fd[i], &value, sizeof(value)) != sizeof(value))
+                value = -1;
+            close(perf_fd[i]);
+            perf_fd[i] = -1;
+        }
+        *dst[i] = value;
+    }
+}
+
+// ---- пиковое потребление памяти ----
+
+// сброс VmHWM (Linux 4.0+), чтобы пик считался для одной нагрузки
+void rss_reset(void) {
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    if (!f) return;
+    fputs("5", f);
+    fclose(f);
+}
+
+long long rss_peak_kb(void) {
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) return -1;
+    char line[256];
+    long long kb = -1;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "VmHWM: %lld kB", &kb) == 1)
+            break;
+    fclose(f);
+    return kb;
+}
+
+// ---- нагрузки ----
+
+Csr build_csr(GenKind kind, long long edges, unsigned long long seed) {
+    Csr g;
+    FILE *f = tmpfile();
+    g.n = (int)gen_write(f, kind, edges, seed);
+    rewind(f);
+
+    int *from = malloc(edges * sizeof(int));
+    int *to = malloc(edges * sizeof(int));
+    long long m = 0;
+    while (m < edges && fscanf(f, "%d %d", &from[m], &to[m]) == 2)
+        m++;
+    fclose(f);
+
+    g.offset = calloc(g.n + 1, sizeof(int));
+    g.target = malloc(m * sizeof(int));
+    for (long long i = 0; i < m; ++i)
+        g.offset[from[i] + 1]++;
+    for (int i = 0; i < g.n; ++i)
+        g.offset[i + 1] += g.offset[i];
+    int *pos = malloc(g.n * sizeof(int));
+    memcpy(pos, g.offset, g.n * sizeof(int));
+    for (long long i = 0; i < m; ++i)
+        g.target[pos[from[i]]++] = to[i];
+
+    free(pos);
+    free(from);
+    free(to);
+    return g;
+}
+
+// выполнение нагрузки; lat != NULL - замер каждой операции в тактах
+long long run_workload(Workload wl, long long n, const Csr *g, uint32_t *lat) {
+    Container c;
+    long long ops = 0;
+    long long check = 0;
+    uint64_t t = 0;
+
+#define TIMED(op) do {                                   \
+        if (lat) t = tick();                             \
+        op;                                              \
+        if (lat) lat[ops] = (uint32_t)(tick() - t);      \
+        ops++;                                           \
+    } while (0)
+
+    if (wl == WL_FIFO) {
+        // заполнение и полное опустошение
+        c_init(&c, (int)n);
+        for (long long i = 0; i < n; ++i)
+            TIMED(c_push(&c, (int)i));
+        while (!c_empty(&c))
+            TIMED(check += c_pop(&c));
+    } else if (wl == WL_STEADY) {
+        // очередь держится на 64 элементах, вставки чередуются с извлечениями
+        c_init(&c, (int)n + 64);
+        for (int i = 0; i < 64; ++i)
+            c_push(&c, i);
+        // номера не повторяются: очередь по корзинам хранит вершины в next[v]
+        for (long long i = 0; i < n / 2; ++i) {
+            TIMED(c_push(&c, (int)(64 + i)));
+            TIMED(check += c_pop(&c));
+        }
+        while (!c_empty(&c))
+            c_pop(&c);
+    } else {
+        // обход метода Кана по настоящему графу
+        int *in_degree = calloc(g->n, sizeof(int));
+        for (int i = 0; i < g->offset[g->n]; ++i)
+            in_degree[g->target[i]]++;
+        c_init(&c, g->n);
+        for (int i = 0; i < g->n; ++i)
+            if (in_degree[i] == 0)
+                TIMED(c_push(&c, i));
+        while (!c_empty(&c)) {
+            int u;
+            TIMED(u = c_pop(&c));
+            check += u;
+            for (int k = g->offset[u]; k < g->offset[u + 1]; ++k)
+                if (--in_degree[g->target[k]] == 0)
+                    TIMED(c_push(&c, g->target[k]));
+        }
+        free(in_degree);
+    }
+#undef TIMED
+
+    c_free(&c);
+    if (check < 0) printf("%lld\n", check); // не даём компилятору выбросить цикл
+    return ops;
+}
+
+int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+double percentile_ns(uint32_t *lat, long long count, double q) {
+    long long idx = (long long)(q * (count - 1));
+    double cycles = (double)lat[idx] - tick_overhead;
+    return (cycles < 0 ? 0 : cycles) * ns_per_tick;
+}
+
+Result measure(Workload wl, long long n, const Csr *g, int repeats) {
+    Result r;
+    memset(&r, 0, sizeof(r));
+    r.workload = workload_names[wl];
+    r.n = n;
+
+    // прогрев и пропускная способность без поопераций замера
+    run_workload(wl, n, g, NULL);
+    rss_reset();
+    double best = -1;
+    for (int i = 0; i < repeats; ++i) {
+        if (i == 0) perf_begin();
+        double t0 = now_sec();
+        r.ops = run_workload(wl, n, g, NULL);
+        double t = now_sec() - t0;
+        if (i == 0) perf_end(&r.cache_misses, &r.branch_misses);
+        if (best < 0 || t < best) best = t;
+    }
+    r.peak_rss_kb = rss_peak_kb();
+    r.ops_per_sec = best > 0 ? r.ops / best : 0;
+
+    // задержки отдельных операций
+    uint32_t *lat = malloc(r.ops * sizeof(uint32_t));
+    run_workload(wl, n, g, lat);
+    qsort(lat, r.ops, sizeof(uint32_t), cmp_u32);
+    r.p50_ns = percentile_ns(lat, r.ops, 0.50);
+    r.p99_ns = percentile_ns(lat, r.ops, 0.99);
+    free(lat);
+    return r;
+}
+
+int main(int argc, char **argv) {
+    long long n = 1000000;
+    int repeats = 3;
+    unsigned long long seed = 1;
+    const char *format = "csv";
+    int kind = GEN_RANDOM;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:S:f:k:h")) != -1) {
+        switch (opt) {
+        case 'n': n = (long long)strtod(optarg, NULL); break;
+        case 'r': repeats = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        case 'f': format = optarg; break;
+        case 'k':
+            kind = gen_kind_parse(optarg);
+            if (kind < 0) {
+                fprintf(stderr, "Неизвестный вид графа: %s\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            fprintf(stderr, "Использование: %s [-n операций] [-r повторы] [-k вид графа] "
+                    "[-S seed] [-f csv|json]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    calibrate();
+    // для kahn граф с n рёбрами: операций очереди 2V
+    Csr g = build_csr((GenKind)kind, n, seed);
+
+    Result res[WL_COUNT];
+    for (int w = 0; w < WL_COUNT; ++w)
+        res[w] = measure((Workload)w, n, &g, repeats);
+
+    int json = strcmp(format, "json") == 0;
+    if (json)
+        printf("[\n");
+    else
+        printf("container,workload,n,ops,ops_per_sec,p50_ns,p99_ns,peak_rss_kb,cache_misses,branch_misses\n");
+    for (int w = 0; w < WL_COUNT; ++w) {
+        Result *r = &res[w];
+        if (json)
+            printf("  {\"container\": \"%s\", \"workload\": \"%s\", \"n\": %lld, \"ops\": %lld, "
+                   "\"ops_per_sec\": %.0f, \"p50_ns\": %.1f, \"p99_ns\": %.1f, "
+                   "\"peak_rss_kb\": %lld, \"cache_misses\": %lld, \"branch_misses\": %lld}%s\n",
+                   CONTAINER_NAME, r->workload, r->n, r->ops, r->ops_per_sec, r->p50_ns, r->p99_ns,
+                   r->peak_rss_kb, r->cache_misses, r->branch_misses, w + 1 < WL_COUNT ? "," : "");
+        else
+            printf("%s,%s,%lld,%lld,%.0f,%.1f,%.1f,%lld,%lld,%lld\n", CONTAINER_NAME, r->workload,
+                   r->n, r->ops, r->ops_per_sec, r->p50_ns, r->p99_ns, r->peak_rss_kb,
+                   r->cache_misses, r->branch_misses);
+    }
+    if (json)
+        printf("]\n");
+
+    free(g.offset);
+    free(g.target);
+    return 0;
+}
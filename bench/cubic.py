@@ -0,0 +1,71 @@
+"""Пропускная способность решения кубических уравнений lab0:
+по одному уравнению (cubic_roots) в каждом режиме и пакетом (cubic_solver_batch)"""
+import argparse
+import os
+import sys
+import time
+
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "lab0"))
+from main import METHODS, cubic_roots, cubic_solver_batch, iteration_counts  # noqa: E402
+
+
+def make_batch(n: int, seed: int):
+    """Случайные уравнения: корни в [-10, 10], треть - с одним вещественным корнем"""
+    rng = np.random.default_rng(seed)
+    r = rng.uniform(-10, 10, size=(n, 3))
+    a = rng.choice([-1.0, 1.0], size=n) * rng.uniform(0.5, 2, size=n)
+    b = -a * r.sum(axis=1)
+    c = a * (r[:, 0] * r[:, 1] + r[:, 0] * r[:, 2] + r[:, 1] * r[:, 2])
+    d = -a * r.prod(axis=1)
+    d[::3] += a[::3] * rng.uniform(50, 500, size=d[::3].size)
+    return a, b, c, d
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser()
+    parser.add_argument("-n", type=int, default=1_000_000, help="уравнений в пакете")
+    parser.add_argument("-s", type=int, default=20_000, help="уравнений для поштучного замера")
+    parser.add_argument("-e", type=float, default=1e-6, help="точность")
+    parser.add_argument("-S", type=int, default=1, help="seed")
+    args = parser.parse_args()
+
+    a, b, c, d = make_batch(args.n, args.S)
+    print("mode,equations,seconds,equations_per_sec,iterations_per_equation,mismatches")
+
+    # поштучно каждым режимом; эталон - комбинированный метод
+    m = min(args.s, args.n)
+    scalar = None
+    for name, method in METHODS.items():
+        iteration_counts[name] = 0
+        t0 = time.perf_counter()
+        with np.errstate(all="ignore"):
+            found = [cubic_roots(args.e, a[i], b[i], c[i], d[i], method)
+                     for i in range(m)]
+        seconds = time.perf_counter() - t0
+        if scalar is None:
+            scalar = found
+        mismatches = sum(
+            1 for x, y in zip(found, scalar)
+            if np.all(np.isfinite(y)) and (len(x) != len(y) or not np.allclose(x, y, rtol=0, atol=2 * args.e)))
+        print(f"scalar_{name},{m},{seconds:.3f},{m / seconds:.0f},{iteration_counts[name] / m:.2f},{mismatches}")
+
+    t0 = time.perf_counter()
+    roots, count = cubic_solver_batch(args.e, a, b, c, d)
+    seconds = time.perf_counter() - t0
+
+    # пакетный путь повторяет поштучный шаг за шагом; уравнения, на которых
+    # поштучный метод получил nan (деление на ноль у сошедшегося отрезка), не сравниваются
+    mismatches = 0
+    for i, expected in enumerate(scalar):
+        if not np.all(np.isfinite(expected)):
+            continue
+        got = roots[i, :count[i]]
+        if len(expected) != count[i] or not np.allclose(got, expected, rtol=0, atol=2 * args.e):
+            mismatches += 1
+    print(f"batch_combined,{args.n},{seconds:.3f},{args.n / seconds:.0f},,{mismatches}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,146 @@
+// бенчмарк удаления повторных рёбер lab1 (-u): параллельная поразрядная
+// сортировка по (from, to) против qsort с последующим проходом уникальности
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#define main lab_main
+#include "../lab1/prog.c"
+#undef main
+
+#include "gen.h"
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// qsort и уникальность за один поток; из повторов остаётся наибольшая задержка
+int qsort_dedup(Edge *edges, int count) {
+    qsort(edges, count, sizeof(Edge), cmp_edge);
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        if (kept > 0 && cmp_edge(&edges[kept - 1], &edges[i]) == 0) {
+            if (edges[i].weight > edges[kept - 1].weight)
+                edges[kept - 1].weight = edges[i].weight;
+            continue;
+        }
+        edges[kept++] = edges[i];
+    }
+    return kept;
+}
+
+void report(const char *kind, int vertices, int edges, const char *method, int threads,
+            double seconds, double base, int removed, int mismatches) {
+    printf("%s,%d,%d,%s,%d,%.4f,%.1f,%.2f,%d,%d\n", kind, vertices, edges, method, threads,
+           seconds, edges / seconds / 1e6, base / seconds, removed, mismatches);
+}
+
+int main(int argc, char **argv) {
+    int kind = GEN_RANDOM;
+    long long edges = 50000000;
+    double duplicates = 0.3;
+    int repeats = 3;
+    int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *path = NULL;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:s:d:r:t:f:S:h")) != -1) {
+        switch (opt) {
+        case 'k':
+            kind = gen_kind_parse(optarg);
+            if (kind < 0) {
+                fprintf(stderr, "Неизвестный вид графа: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 's': edges = (long long)strtod(optarg, NULL); break;
+        case 'd': duplicates = strtod(optarg, NULL); break;
+        case 'r': repeats = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 't': max_threads = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'f': path = optarg; break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s [-k вид графа] [-s рёбер] [-d доля повторов] "
+                    "[-r повторы] [-t потоков] [-f файл] [-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // рёбра графа, к ним - копии случайных рёбер, всё вперемешку, как после
+    // слияния нескольких источников; задержки случайные, чтобы проверить их слияние
+    Edge *input = NULL;
+    int capacity = 0, count;
+    if (path) {
+        count = read_edges(path, &input, &capacity, NULL);
+    } else {
+        FILE *f = tmpfile();
+        gen_write(f, (GenKind)kind, (long long)(edges / (1 + duplicates)), seed);
+        rewind(f);
+        count = read_edges_stream(f, &input, &capacity, NULL);
+        fclose(f);
+    }
+    if (count <= 0)
+        return 1;
+    unsigned long long state = seed;
+    int extra = path ? 0 : (int)(count * duplicates);
+    input = realloc(input, (size_t)(count + extra) * sizeof(Edge));
+    for (int i = 0; i < extra; ++i)
+        input[count + i] = input[gen_range(&state, count)];
+    count += extra;
+    for (int i = count - 1; i > 0; --i) {
+        int j = (int)gen_range(&state, i + 1);
+        Edge t = input[i];
+        input[i] = input[j];
+        input[j] = t;
+    }
+    for (int i = 0; i < count; ++i)
+        input[i].weight = (int)gen_range(&state, 10);
+    int vertex_count = find_vertex_count(input, count);
+    const char *kname = path ? "file" : gen_kind_names[kind];
+
+    printf("kind,vertices,edges,method,threads,seconds,medges_per_sec,speedup,removed,"
+           "mismatches\n");
+
+    // qsort служит эталоном
+    Edge *expected = malloc((size_t)count * sizeof(Edge));
+    double base = -1;
+    int expected_count = 0;
+    for (int r = 0; r < repeats; ++r) {
+        memcpy(expected, input, (size_t)count * sizeof(Edge));
+        double t0 = now_sec();
+        expected_count = qsort_dedup(expected, count);
+        double t = now_sec() - t0;
+        if (base < 0 || t < base) base = t;
+    }
+    report(kname, vertex_count, count, "qsort", 1, base, base, count - expected_count, 0);
+
+    Workspace ws = {0};
+    ws.edges = malloc((size_t)count * sizeof(Edge));
+    ws.edge_capacity = count;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double best = -1;
+        int kept = 0, removed = 0;
+        for (int r = 0; r < repeats; ++r) {
+            memcpy(ws.edges, input, (size_t)count * sizeof(Edge));
+            double t0 = now_sec();
+            kept = dedup_edges(&ws, count, vertex_count, threads, &removed);
+            double t = now_sec() - t0;
+            if (best < 0 || t < best) best = t;
+        }
+        int mismatches = kept != expected_count
+                         || memcmp(ws.edges, expected, (size_t)kept * sizeof(Edge)) != 0;
+        report(kname, vertex_count, count, "radix", threads, best, base, removed, mismatches);
+    }
+
+    free(expected);
+    free(input);
+    free_workspace(&ws);
+    return 0;
+}
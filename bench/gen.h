@@ -0,0 +1,120 @@
+// генератор синтетических графов для бенчмарков
+#ifndef GEN_H
+#define GEN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GEN_LAYERS 8
+#define GEN_CYCLE_EVERY 1000
+
+typedef enum { GEN_RANDOM, GEN_CHAIN, GEN_LAYERED, GEN_CYCLIC, GEN_KIND_COUNT } GenKind;
+
+static const char *gen_kind_names[GEN_KIND_COUNT] = { "random", "chain", "layered", "cyclic" };
+
+// разбор названия вида графа, -1 если не найден
+static inline int gen_kind_parse(const char *name) {
+    for (int i = 0; i < GEN_KIND_COUNT; ++i)
+        if (strcmp(name, gen_kind_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+// генератор псевдослучайных чисел splitmix64
+static inline unsigned long long gen_next(unsigned long long *state) {
+    unsigned long long z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// случайное число из [0, n)
+static inline long long gen_range(unsigned long long *state, long long n) {
+    return (long long)(((unsigned __int128)gen_next(state) * (unsigned long long)n) >> 64);
+}
+
+// число вершин для заданного вида графа и числа рёбер
+static inline long long gen_vertex_count(GenKind kind, long long edges) {
+    long long n;
+    switch (kind) {
+    case GEN_CHAIN:
+        return edges + 1;
+    case GEN_LAYERED:
+        n = edges / 4;
+        return n < 2 * GEN_LAYERS ? 2 * GEN_LAYERS : n;
+    default:
+        n = edges / 8; // средняя полустепень исхода 8
+        return n < 4 ? 4 : n;
+    }
+}
+
+// случайная перестановка номеров вершин, чтобы порядок не совпадал с нумерацией
+static inline int *gen_permutation(long long n, unsigned long long *state) {
+    int *perm = malloc(n * sizeof(int));
+    for (long long i = 0; i < n; ++i)
+        perm[i] = (int)i;
+    for (long long i = n - 1; i > 0; --i) {
+        long long j = gen_range(state, i + 1);
+        int t = perm[i];
+        perm[i] = perm[j];
+        perm[j] = t;
+    }
+    return perm;
+}
+
+// случайная пара a < b из [0, n)
+static inline void gen_pair(unsigned long long *state, long long n, long long *a, long long *b) {
+    do {
+        *a = gen_range(state, n);
+        *b = gen_range(state, n);
+    } while (*a == *b);
+    if (*a > *b) {
+        long long t = *a;
+        *a = *b;
+        *b = t;
+    }
+}
+
+// запись графа в файл в формате "u v" по ребру на строку, возвращает число вершин
+//   random  - случайный DAG
+//   chain   - одна длинная цепочка
+//   layered - GEN_LAYERS широких слоёв, рёбра между соседними слоями
+//   cyclic  - случайный DAG с подсаженными циклами длины 3
+static inline long long gen_write(FILE *f, GenKind kind, long long edges, unsigned long long seed) {
+    unsigned long long state = seed;
+    long long n = gen_vertex_count(kind, edges);
+    int *perm = gen_permutation(n, &state);
+    long long a, b, c;
+
+    if (kind == GEN_CHAIN) {
+        for (long long i = 0; i < edges; ++i)
+            fprintf(f, "%d %d\n", perm[i], perm[i + 1]);
+    } else if (kind == GEN_LAYERED) {
+        long long width = n / GEN_LAYERS;
+        for (long long i = 0; i < edges; ++i) {
+            long long layer = gen_range(&state, GEN_LAYERS - 1);
+            a = layer * width + gen_range(&state, width);
+            b = (layer + 1) * width + gen_range(&state, width);
+            fprintf(f, "%d %d\n", perm[a], perm[b]);
+        }
+    } else {
+        long long i = 0;
+        while (i < edges) {
+            gen_pair(&state, n, &a, &b);
+            if (kind == GEN_CYCLIC && i % GEN_CYCLE_EVERY == 0 && b - a >= 2 && i + 3 <= edges) {
+                c = a + 1 + gen_range(&state, b - a - 1);
+                fprintf(f, "%d %d\n%d %d\n%d %d\n", perm[a], perm[c], perm[c], perm[b], perm[b], perm[a]);
+                i += 3;
+            } else {
+                fprintf(f, "%d %d\n", perm[a], perm[b]);
+                i++;
+            }
+        }
+    }
+
+    free(perm);
+    return n;
+}
+
+#endif
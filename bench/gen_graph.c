@@ -0,0 +1,24 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gen.h"
+
+// генерация графа для лабораторных: gen_graph <вид> <рёбра> [seed] > файл
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Использование: %s random|chain|layered|cyclic <число рёбер> [seed]\n", argv[0]);
+        return 1;
+    }
+
+    int kind = gen_kind_parse(argv[1]);
+    long long edges = (long long)strtod(argv[2], NULL);
+    unsigned long long seed = argc > 3 ? strtoull(argv[3], NULL, 10) : 1;
+    if (kind < 0 || edges <= 0) {
+        fprintf(stderr, "Некорректный вид графа или число рёбер\n");
+        return 1;
+    }
+
+    long long n = gen_write(stdout, (GenKind)kind, edges, seed);
+    fprintf(stderr, "Вершин: %lld, рёбер: %lld\n", n, edges);
+    return 0;
+}
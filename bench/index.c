@@ -0,0 +1,118 @@
+// бенчмарк суффиксного массива lab4: время построения, память и запросы
+// count/locate по тексту порядка в сравнении с просмотром текста Turbo-BM
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#define main lab_main
+#include "../lab4/main.c"
+#undef main
+
+#include "gen.h"
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// запросы - последовательности из 1-4 соседних вершин порядка, как их ищут
+// пользователи, и каждый четвёртый - случайное число, которого может не быть
+char **make_queries(const int *order, int count, int queries, unsigned long long seed) {
+    unsigned long long state = seed;
+    char **q = malloc(queries * sizeof(char *));
+    for (int i = 0; i < queries; ++i) {
+        char buf[64];
+        int len = 0;
+        if (i % 4 == 3) {
+            sprintf(buf, "%lld", gen_range(&state, 2LL * count));
+        } else {
+            int k = 1 + (int)gen_range(&state, 4);
+            int start = (int)gen_range(&state, count - k + 1);
+            for (int j = 0; j < k; ++j)
+                len += sprintf(buf + len, j ? " %d" : "%d", order[start + j]);
+        }
+        q[i] = strdup(buf);
+    }
+    return q;
+}
+
+int main(int argc, char **argv) {
+    int count = 1000000;
+    int queries = 100000;
+    int scan_queries = 100;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:q:b:S:h")) != -1) {
+        switch (opt) {
+        case 'n': count = (int)strtod(optarg, NULL); break;
+        case 'q': queries = (int)strtod(optarg, NULL); break;
+        case 'b': scan_queries = atoi(optarg); break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s [-n вершин] [-q запросов] "
+                    "[-b запросов просмотром] [-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (count < 4) count = 4;
+    if (scan_queries > queries) scan_queries = queries;
+
+    // текст в том же виде, что строит process_and_search
+    unsigned long long state = seed;
+    int *order = gen_permutation(count, &state);
+    char *text = malloc((size_t)count * 12 + 1);
+    int len = 0;
+    for (int i = 0; i < count; ++i)
+        len += sprintf(text + len, i ? " %d" : "%d", order[i]);
+    char **q = make_queries(order, count, queries, seed + 1);
+
+    SuffixIndex idx;
+    double t0 = now_sec();
+    suffix_index_build(&idx, text, len);
+    double build = now_sec() - t0;
+    long long bytes = suffix_index_bytes(&idx);
+
+    printf("method,text_len,build_sec,index_bytes,bytes_per_char,queries,qps,matches,mismatches\n");
+
+    // запросы по индексу: число вхождений и первая позиция
+    long long *counts = malloc(queries * sizeof(long long));
+    int *firsts = malloc(queries * sizeof(int));
+    long long total = 0;
+    t0 = now_sec();
+    for (int i = 0; i < queries; ++i) {
+        counts[i] = suffix_index_count(&idx, q[i], &firsts[i]);
+        total += counts[i];
+    }
+    double seconds = now_sec() - t0;
+    printf("suffix_array,%d,%.6f,%lld,%.1f,%d,%.0f,%lld,0\n", len, build, bytes,
+           (double)bytes / len, queries, queries / seconds, total);
+
+    // просмотр текста на части запросов служит эталоном
+    int mismatches = 0;
+    total = 0;
+    t0 = now_sec();
+    for (int i = 0; i < scan_queries; ++i) {
+        long long matches;
+        int pos = turbo_bm_search(text, q[i], &matches);
+        total += matches;
+        mismatches += matches != counts[i] || pos != firsts[i];
+    }
+    seconds = now_sec() - t0;
+    printf("turbo_bm_scan,%d,0,0,0,%d,%.0f,%lld,%d\n", len, scan_queries,
+           scan_queries / seconds, total, mismatches);
+
+    for (int i = 0; i < queries; ++i)
+        free(q[i]);
+    free(q);
+    free(counts);
+    free(firsts);
+    suffix_index_free(&idx);
+    free(text);
+    free(order);
+    return 0;
+}
@@ -0,0 +1,135 @@
+// бенчмарк чтения графа lab1: построчный fgets против конвейерного чтения
+// потоком и через io_uring, пропускная способность каждого этапа
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#define main lab_main
+#include "../lab1/prog.c"
+#undef main
+
+#include "gen.h"
+
+static const char *ingest_names[3] = { "stdio", "thread", "uring" };
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// вытеснение файла из страничного кэша, чтобы чтение шло с диска
+void drop_cache(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+int main(int argc, char **argv) {
+    int kind = GEN_RANDOM;
+    long long edges = 10000000;
+    int repeats = 3;
+    int cold = 0;
+    const char *path = NULL;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:s:r:f:dS:h")) != -1) {
+        switch (opt) {
+        case 'k':
+            kind = gen_kind_parse(optarg);
+            if (kind < 0) {
+                fprintf(stderr, "Неизвестный вид графа: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 's': edges = (long long)strtod(optarg, NULL); break;
+        case 'r': repeats = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'f': path = optarg; break;
+        case 'd': cold = 1; break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s [-k вид графа] [-s рёбер] [-r повторы] "
+                    "[-f файл] [-d] [-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // граф во временном файле, если не задан готовый
+    char tmp_path[] = "/tmp/ingest_XXXXXX";
+    if (!path) {
+        int fd = mkstemp(tmp_path);
+        FILE *f = fdopen(fd, "w");
+        gen_write(f, (GenKind)kind, edges, seed);
+        fclose(f);
+        path = tmp_path;
+    }
+
+    printf("mode,edges,mb,read_sec,read_mb_per_sec,parse_sec,parse_mb_per_sec,wait_sec,"
+           "ingest_sec,count_sec,build_sec,sort_sec,total_sec,mismatches\n");
+    Edge *expected = NULL;
+    int expected_count = 0;
+    for (int mode = INGEST_STDIO; mode <= INGEST_URING; ++mode) {
+        for (int r = 0; r < repeats; ++r) {
+            if (cold)
+                drop_cache(path);
+            Workspace ws = {0};
+            ingest_mode = mode;
+            double t0 = now_sec();
+            int count = mode == INGEST_STDIO
+                ? read_edges(path, &ws.edges, &ws.edge_capacity, NULL)
+                : read_edges_pipelined(path, &ws.edges, &ws.edge_capacity, NULL, &ws.vertex_count);
+            double t1 = now_sec();
+            if (count <= 0)
+                return 1;
+
+            // число вершин - отдельный проход только у построчного чтения
+            int vertex_count = ws.vertex_count ? ws.vertex_count
+                                               : find_vertex_count(ws.edges, count);
+            double t2 = now_sec();
+            Graph g;
+            build_graph(&g, &ws, count, vertex_count, STORAGE_SPARSE);
+            double t3 = now_sec();
+            int *result = malloc(vertex_count * sizeof(int));
+            kahn_order(&g, result);
+            double t4 = now_sec();
+            free(result);
+
+            // построчное чтение служит эталоном
+            int mismatches = 0;
+            if (!expected) {
+                expected = malloc(count * sizeof(Edge));
+                memcpy(expected, ws.edges, count * sizeof(Edge));
+                expected_count = count;
+            } else {
+                mismatches = count != expected_count
+                             || memcmp(expected, ws.edges, count * sizeof(Edge)) != 0;
+            }
+
+            // у построчного чтения чтение и разбор не разделить: всё время - разбор
+            struct stat st;
+            stat(path, &st);
+            double mb = st.st_size / 1e6;
+            double read_sec = mode == INGEST_THREAD ? ingest_stats.read_sec : 0;
+            double parse_sec = mode == INGEST_STDIO ? t1 - t0 : ingest_stats.parse_sec;
+            const char *name = ingest_names[mode == INGEST_STDIO ? mode : ingest_stats.mode];
+            printf("%s,%d,%.1f,%.4f,%.0f,%.4f,%.0f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%d\n", name,
+                   count, mb, read_sec, read_sec > 0 ? mb / read_sec : 0, parse_sec,
+                   mb / parse_sec, mode == INGEST_STDIO ? 0 : ingest_stats.wait_sec, t1 - t0,
+                   t2 - t1, t3 - t2, t4 - t3, t4 - t0, mismatches);
+            free_workspace(&ws);
+        }
+    }
+
+    free(expected);
+    if (path == tmp_path)
+        unlink(tmp_path);
+    return 0;
+}
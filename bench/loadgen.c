@@ -0,0 +1,266 @@
+// генератор нагрузки для сервера lab1 (-D): несколько клиентов отправляют один и
+// тот же граф, выводятся запросы в секунду и перцентили задержки; для сравнения
+// тот же граф можно сортировать отдельным процессом на каждый запрос (-e)
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "gen.h"
+
+#define MAX_CLIENTS 256
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    const char *socket_path;    // NULL - процесс на запрос
+    const char *lab_path;
+    const char *graph_path;
+    const char *method;
+    const char *output;
+    char *request;              // заголовок и рёбра
+    size_t request_len;
+    int per_client;
+    uint64_t expected;          // хеш ответа первого запроса
+    pthread_mutex_t lock;
+} Load;
+
+typedef struct {
+    Load *load;
+    double *latency;
+    int failed, mismatches;
+} Client;
+
+uint64_t hash_bytes(uint64_t h, const char *p, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        h = (h ^ (unsigned char)p[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+// чтение ответа до конца потока, возвращает хеш или 0 при ошибке
+uint64_t read_response(int fd) {
+    char buf[1 << 16];
+    uint64_t h = 0xcbf29ce484222325ULL;
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        h = hash_bytes(h, buf, (size_t)n);
+    return n < 0 ? 0 : h;
+}
+
+int write_all(int fd, const char *p, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0)
+            return -1;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+// один запрос к серверу
+uint64_t request_daemon(Load *l) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strncpy(addr.sun_path, l->socket_path, sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    uint64_t h = 0;
+    if (write_all(fd, l->request, l->request_len) == 0) {
+        shutdown(fd, SHUT_WR);
+        h = read_response(fd);
+    }
+    close(fd);
+    return h;
+}
+
+// тот же граф отдельным процессом lab1 из файла
+uint64_t request_process(Load *l) {
+    int pipefd[2];
+    if (pipe(pipefd) != 0)
+        return 0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(pipefd[1], 1);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, 2);
+        execl(l->lab_path, l->lab_path, "-f", l->graph_path, "-m", l->method, "-s", "sparse",
+              "-o", l->output, (char *)NULL);
+        _exit(127);
+    }
+    close(pipefd[1]);
+    uint64_t h = read_response(pipefd[0]);
+    close(pipefd[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? h : 0;
+}
+
+void *client_main(void *arg) {
+    Client *c = arg;
+    Load *l = c->load;
+    for (int i = 0; i < l->per_client; ++i) {
+        double t0 = now_sec();
+        uint64_t h = l->socket_path ? request_daemon(l) : request_process(l);
+        c->latency[i] = now_sec() - t0;
+        if (!h) {
+            c->failed++;
+            continue;
+        }
+        // ответы на одинаковые запросы должны совпадать
+        pthread_mutex_lock(&l->lock);
+        if (!l->expected)
+            l->expected = h;
+        c->mismatches += h != l->expected;
+        pthread_mutex_unlock(&l->lock);
+    }
+    return NULL;
+}
+
+int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double percentile_us(const double *sorted, int n, double p) {
+    int i = (int)(p * (n - 1) + 0.5);
+    return sorted[i] * 1e6;
+}
+
+void run(Load *l, int clients, const char *mode, const char *kind, long long edges) {
+    Client cs[MAX_CLIENTS];
+    pthread_t threads[MAX_CLIENTS];
+    l->expected = 0;
+    double t0 = now_sec();
+    for (int i = 0; i < clients; ++i) {
+        cs[i].load = l;
+        cs[i].latency = malloc(l->per_client * sizeof(double));
+        cs[i].failed = cs[i].mismatches = 0;
+        pthread_create(&threads[i], NULL, client_main, &cs[i]);
+    }
+    int total = clients * l->per_client, failed = 0, mismatches = 0;
+    double *all = malloc(total * sizeof(double));
+    for (int i = 0; i < clients; ++i) {
+        pthread_join(threads[i], NULL);
+        memcpy(all + (size_t)i * l->per_client, cs[i].latency, l->per_client * sizeof(double));
+        failed += cs[i].failed;
+        mismatches += cs[i].mismatches;
+        free(cs[i].latency);
+    }
+    double seconds = now_sec() - t0;
+    qsort(all, total, sizeof(double), cmp_double);
+    printf("%s,%s,%lld,%s,%s,%d,%d,%.3f,%.0f,%.1f,%.1f,%.1f,%.1f,%d,%d\n", mode, kind, edges,
+           l->method, l->output, clients, total, seconds, total / seconds,
+           percentile_us(all, total, 0.5), percentile_us(all, total, 0.9),
+           percentile_us(all, total, 0.99), all[total - 1] * 1e6, failed, mismatches);
+    free(all);
+}
+
+int main(int argc, char **argv) {
+    const char *socket_path = NULL, *lab_path = NULL;
+    const char *method = "kahn", *input = "text", *output = "binary";
+    int kind = GEN_RANDOM;
+    long long edges = 10000;
+    int requests = 10000;
+    int clients = 4;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "S:e:k:s:n:c:m:i:o:r:h")) != -1) {
+        switch (opt) {
+        case 'S': socket_path = optarg; break;
+        case 'e': lab_path = optarg; break;
+        case 'k':
+            kind = gen_kind_parse(optarg);
+            if (kind < 0) {
+                fprintf(stderr, "Неизвестный вид графа: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 's': edges = (long long)strtod(optarg, NULL); break;
+        case 'n': requests = (int)strtod(optarg, NULL); break;
+        case 'c': clients = atoi(optarg); break;
+        case 'm': method = optarg; break;
+        case 'i': input = optarg; break;
+        case 'o': output = optarg; break;
+        case 'r': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s -S сокет [-e lab1] [-k вид графа] [-s рёбер] "
+                    "[-n запросов] [-c клиентов] [-m метод] [-i text|binary] [-o text|binary] "
+                    "[-r seed]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!socket_path && !lab_path) {
+        fprintf(stderr, "Нужен сокет сервера (-S) или программа lab1 (-e)\n");
+        return 1;
+    }
+    if (clients < 1) clients = 1;
+    if (clients > MAX_CLIENTS) clients = MAX_CLIENTS;
+
+    // граф в файле для процессов и в памяти для запросов серверу
+    char graph_path[] = "/tmp/loadgen_XXXXXX";
+    int fd = mkstemp(graph_path);
+    FILE *f = fdopen(fd, "w+");
+    gen_write(f, (GenKind)kind, edges, seed);
+    fflush(f);
+
+    Load l = { 0 };
+    l.graph_path = graph_path;
+    l.lab_path = lab_path;
+    l.method = method;
+    l.output = output;
+    l.per_client = (requests + clients - 1) / clients;
+    pthread_mutex_init(&l.lock, NULL);
+
+    char *text;
+    size_t text_len;
+    FILE *req = open_memstream(&text, &text_len);
+    fprintf(req, "%s %s %s\n", method, input, output);
+    rewind(f);
+    long long u, v;
+    while (fscanf(f, "%lld %lld", &u, &v) == 2) {
+        if (strcmp(input, "binary") == 0) {
+            int32_t pair[2] = { (int32_t)u, (int32_t)v };   // little-endian на x86
+            fwrite(pair, sizeof(pair), 1, req);
+        } else {
+            fprintf(req, "%lld %lld\n", u, v);
+        }
+    }
+    fclose(req);
+    fclose(f);
+    l.request = text;
+    l.request_len = text_len;
+
+    printf("mode,kind,edges,method,output,clients,requests,seconds,requests_per_sec,"
+           "p50_us,p90_us,p99_us,max_us,failed,mismatches\n");
+    if (socket_path) {
+        l.socket_path = socket_path;
+        run(&l, clients, "daemon", gen_kind_names[kind], edges);
+    }
+    if (lab_path) {
+        l.socket_path = NULL;
+        run(&l, clients, "process", gen_kind_names[kind], edges);
+    }
+
+    unlink(graph_path);
+    free(text);
+    return 0;
+}
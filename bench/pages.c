@@ -0,0 +1,133 @@
+// бенчмарк больших страниц и размещения по узлам NUMA lab1 (-H, -N): время
+// построения CSR и сортировки при разных страницах и сводка -M по страницам
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#define main lab_main
+#include "../lab1/prog.c"
+#undef main
+
+#include "gen.h"
+
+static const char *page_names[3] = { "default", "thp", "huge" };
+static const char *numa_names[3] = { "none", "interleave", "local" };
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+    int kind = GEN_RANDOM;
+    long long edges = 20000000;
+    int repeats = 3;
+    const char *path = NULL;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:s:r:f:S:h")) != -1) {
+        switch (opt) {
+        case 'k':
+            kind = gen_kind_parse(optarg);
+            if (kind < 0) {
+                fprintf(stderr, "Неизвестный вид графа: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 's': edges = (long long)strtod(optarg, NULL); break;
+        case 'r': repeats = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'f': path = optarg; break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s [-k вид графа] [-s рёбер] [-r повторы] "
+                    "[-f файл] [-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // исходные рёбра читаются один раз обычным malloc
+    Edge *input = NULL;
+    int capacity = 0, count;
+    if (path) {
+        count = read_edges(path, &input, &capacity, NULL);
+    } else {
+        FILE *f = tmpfile();
+        gen_write(f, (GenKind)kind, edges, seed);
+        rewind(f);
+        count = read_edges_stream(f, &input, &capacity, NULL);
+        fclose(f);
+    }
+    if (count <= 0)
+        return 1;
+    int vertex_count = find_vertex_count(input, count);
+    const char *kname = path ? "file" : gen_kind_names[kind];
+
+    // порядок Тарьяна не нужен, только время
+    out.fd = open("/dev/null", O_WRONLY);
+
+    printf("kind,vertices,edges,pages,numa,build_sec,kahn_sec,tarjan_sec,total_sec,speedup,"
+           "mb_4k,mb_thp,mb_hugetlb,fallbacks,mismatches\n");
+    int *expected = malloc(vertex_count * sizeof(int));
+    int expected_count = 0;
+    double base = 0;
+    for (int numa = NUMA_DEFAULT; numa <= NUMA_LOCAL; ++numa) {
+        for (int pages = PAGES_DEFAULT; pages <= PAGES_HUGETLB; ++pages) {
+            page_mode = pages;
+            numa_mode = numa;
+            memory_report = 1;
+            double build = -1, kahn = -1, tarjan = -1;
+            int mismatches = 0;
+            // каждый повтор - с новыми массивами: в замер входят и сбои страниц
+            for (int r = 0; r < repeats; ++r) {
+                memset(&mem_stats, 0, sizeof(mem_stats));
+                Workspace ws = {0};
+                ws.edges = big_alloc(count * sizeof(Edge));
+                ws.edge_capacity = count;
+                memcpy(ws.edges, input, count * sizeof(Edge));
+                int *result = big_alloc(vertex_count * sizeof(int));
+                Graph g;
+                double t0 = now_sec();
+                build_graph(&g, &ws, count, vertex_count, STORAGE_SPARSE);
+                double t1 = now_sec();
+                int ordered = kahn_order(&g, result);
+                double t2 = now_sec();
+                top_sort_tarjan(&g);
+                double t3 = now_sec();
+                if (build < 0 || t1 - t0 < build) build = t1 - t0;
+                if (kahn < 0 || t2 - t1 < kahn) kahn = t2 - t1;
+                if (tarjan < 0 || t3 - t2 < tarjan) tarjan = t3 - t2;
+
+                // порядок Кана на обычных страницах служит эталоном
+                if (numa == NUMA_DEFAULT && pages == PAGES_DEFAULT && r == 0) {
+                    memcpy(expected, result, ordered * sizeof(int));
+                    expected_count = ordered;
+                } else {
+                    mismatches |= ordered != expected_count
+                                  || memcmp(expected, result, ordered * sizeof(int)) != 0;
+                }
+                big_free(result);
+                free_workspace(&ws);
+            }
+            double total = build + kahn + tarjan;
+            if (numa == NUMA_DEFAULT && pages == PAGES_DEFAULT)
+                base = total;
+            const double mb = 1 << 20;
+            printf("%s,%d,%d,%s,%s,%.4f,%.4f,%.4f,%.4f,%.2f,%.1f,%.1f,%.1f,%d,%d\n", kname,
+                   vertex_count, count, page_names[pages], numa_names[numa], build, kahn, tarjan,
+                   total, base / total, mem_stats.page_bytes[0] / mb,
+                   mem_stats.page_bytes[1] / mb, mem_stats.page_bytes[2] / mb,
+                   mem_stats.hugetlb_fallbacks, mismatches);
+        }
+    }
+
+    free(expected);
+    free(input);
+    close(out.fd);
+    return 0;
+}
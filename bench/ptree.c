@@ -0,0 +1,174 @@
+// бенчмарк дерева lab4 при одном писателе и нескольких читателях:
+// персистентное дерево без блокировок против красно-чёрного под rwlock
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#define main lab_main
+#include "../lab4/main.c"
+#undef main
+
+#include "gen.h"
+
+#define MAX_THREADS 64
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef enum { IMPL_PERSISTENT, IMPL_RWLOCK } Impl;
+
+typedef struct {
+    Impl impl;
+    int *keys;
+    int n;
+    atomic_int done;
+    // персистентное дерево
+    PTree ptree;
+    // красно-чёрное дерево под блокировкой, size - число вставленных ключей
+    RBTree tree;
+    int size;
+    pthread_rwlock_t lock;
+} Shared;
+
+typedef struct {
+    Shared *sh;
+    int id;
+    long long lookups, mismatches;
+} Reader;
+
+// читатель ищет случайный уже вставленный ключ: снимок из size узлов
+// должен содержать первые size ключей, иначе это расхождение
+void *reader_main(void *arg) {
+    Reader *r = arg;
+    Shared *sh = r->sh;
+    unsigned long long state = 1000 + r->id;
+    int slot = sh->impl == IMPL_PERSISTENT ? ptree_reader_register(&sh->ptree) : -1;
+    while (!atomic_load_explicit(&sh->done, memory_order_relaxed)) {
+        for (int k = 0; k < 64; ++k) {
+            int found, size;
+            long long key;
+            if (sh->impl == IMPL_PERSISTENT) {
+                PNode *root = ptree_read_begin(&sh->ptree, slot);
+                size = pnode_size(root);
+                key = size ? sh->keys[gen_range(&state, size)] : -1;
+                found = size ? ptree_search(root, key) : 1;
+                ptree_read_end(&sh->ptree, slot);
+            } else {
+                pthread_rwlock_rdlock(&sh->lock);
+                size = sh->size;
+                key = size ? sh->keys[gen_range(&state, size)] : -1;
+                found = size ? search_rbtree(&sh->tree, key) != sh->tree.nil : 1;
+                pthread_rwlock_unlock(&sh->lock);
+            }
+            r->lookups++;
+            r->mismatches += !found;
+        }
+    }
+    return NULL;
+}
+
+void run(Impl impl, int n, int readers, unsigned long long seed) {
+    Shared sh;
+    memset(&sh, 0, sizeof(sh));
+    sh.impl = impl;
+    sh.n = n;
+    unsigned long long state = seed;
+    sh.keys = gen_permutation(n, &state);
+    atomic_init(&sh.done, 0);
+    init_ptree(&sh.ptree);
+    init_rbtree(&sh.tree);
+    // по умолчанию glibc пропускает вперёд читателей, и писатель может не дождаться
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&sh.lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+
+    pthread_t threads[MAX_THREADS];
+    Reader rs[MAX_THREADS];
+    for (int i = 0; i < readers; ++i) {
+        rs[i].sh = &sh;
+        rs[i].id = i;
+        rs[i].lookups = rs[i].mismatches = 0;
+        pthread_create(&threads[i], NULL, reader_main, &rs[i]);
+    }
+
+    // писатель - текущий поток
+    size_t max_backlog = 0;
+    double t0 = now_sec();
+    for (int i = 0; i < n; ++i) {
+        if (impl == IMPL_PERSISTENT) {
+            insert_ptree(&sh.ptree, sh.keys[i]);
+            size_t backlog = sh.ptree.retired_len - sh.ptree.retired_head;
+            if (backlog > max_backlog) max_backlog = backlog;
+        } else {
+            pthread_rwlock_wrlock(&sh.lock);
+            insert_rbtree(&sh.tree, sh.keys[i]);
+            sh.size = i + 1;
+            pthread_rwlock_unlock(&sh.lock);
+        }
+    }
+    double seconds = now_sec() - t0;
+    atomic_store(&sh.done, 1);
+
+    long long lookups = 0, mismatches = 0;
+    for (int i = 0; i < readers; ++i) {
+        pthread_join(threads[i], NULL);
+        lookups += rs[i].lookups;
+        mismatches += rs[i].mismatches;
+    }
+
+    printf("%s,%d,%d,%.6f,%.0f,%.0f,%lld,%zu,%lld,%lld\n",
+           impl == IMPL_PERSISTENT ? "persistent" : "rwlock", n, readers, seconds, n / seconds,
+           lookups / seconds, mismatches, max_backlog, sh.ptree.allocated, sh.ptree.freed);
+
+    free_ptree(&sh.ptree);
+    pthread_rwlock_destroy(&sh.lock);
+    free(sh.keys);
+    // узлы красно-чёрного дерева в лабораторной не освобождаются, в бенчмарке тоже
+}
+
+int main(int argc, char **argv) {
+    int n = 1000000;
+    int counts[16] = { 1, 2, 4, 8 };
+    int count_len = 4;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:S:h")) != -1) {
+        char *list, *tok;
+        switch (opt) {
+        case 'n': n = (int)strtod(optarg, NULL); break;
+        case 't':
+            count_len = 0;
+            list = strdup(optarg);
+            for (tok = strtok(list, ","); tok && count_len < 16; tok = strtok(NULL, ","))
+                counts[count_len++] = atoi(tok);
+            free(list);
+            break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s [-n ключей] [-t читателей,...] [-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("tree,keys,readers,writer_sec,inserts_per_sec,lookups_per_sec,mismatches,"
+           "max_retired,nodes_allocated,nodes_freed\n");
+    for (int c = 0; c < count_len; ++c) {
+        int readers = counts[c];
+        if (readers < 0) readers = 0;
+        if (readers > MAX_THREADS) readers = MAX_THREADS;
+        if (readers > PTREE_READERS) readers = PTREE_READERS;
+        run(IMPL_PERSISTENT, n, readers, seed);
+        run(IMPL_RWLOCK, n, readers, seed);
+    }
+    return 0;
+}
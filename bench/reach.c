@@ -0,0 +1,171 @@
+// бенчмарк индекса достижимости lab1: запросов в секунду у замыкания,
+// интервальных меток и обычного обхода в глубину на каждый запрос
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#define main lab_main
+#include "../lab1/prog.c"
+#undef main
+
+#include "gen.h"
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// обычный обход в глубину от u на каждый запрос, как в dfs_tarjan
+int dfs_reach(const Graph *g, int u, int v, unsigned *stamp, unsigned mark, int *stack) {
+    int top = 0;
+    stack[top++] = u;
+    stamp[u] = mark;
+    while (top > 0) {
+        int x = stack[--top];
+        if (x == v)
+            return 1;
+        SuccIter it;
+        succ_begin(g, x, &it);
+        for (int w = succ_next(g, x, &it); w >= 0; w = succ_next(g, x, &it)) {
+            if (stamp[w] != mark) {
+                stamp[w] = mark;
+                stack[top++] = w;
+            }
+        }
+    }
+    return 0;
+}
+
+// запросы: половина - случайные пары, половина - конец случайного пути из u
+void make_queries(const Graph *g, int count, unsigned long long seed, int *from, int *to) {
+    unsigned long long state = seed;
+    for (int i = 0; i < count; ++i) {
+        from[i] = (int)gen_range(&state, g->vertex_count);
+        if (i % 2 == 0) {
+            to[i] = (int)gen_range(&state, g->vertex_count);
+            continue;
+        }
+        int v = from[i];
+        int steps = 1 + (int)gen_range(&state, 16);
+        for (int s = 0; s < steps; ++s) {
+            int deg = g->offset[v + 1] - g->offset[v];
+            if (deg == 0)
+                break;
+            v = g->target[g->offset[v] + gen_range(&state, deg)];
+        }
+        to[i] = v;
+    }
+}
+
+void report(const char *kind, long long edges, int n, const char *index, double build,
+            long long bytes, int queries, double seconds, int positives, int mismatches) {
+    printf("%s,%lld,%d,%s,%.6f,%lld,%d,%.0f,%d,%d\n", kind, edges, n, index, build, bytes,
+           queries, seconds > 0 ? queries / seconds : 0, positives, mismatches);
+}
+
+int main(int argc, char **argv) {
+    long long edges = 1000000;
+    int queries = 100000;
+    int kind = GEN_RANDOM;
+    int labels = GRAIL_LABELS;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:s:q:l:S:h")) != -1) {
+        switch (opt) {
+        case 'k':
+            kind = gen_kind_parse(optarg);
+            if (kind < 0 || kind == GEN_CYCLIC) {
+                fprintf(stderr, "Нужен ациклический вид графа: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 's': edges = (long long)strtod(optarg, NULL); break;
+        case 'q': queries = atoi(optarg); break;
+        case 'l': labels = atoi(optarg); break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s [-k вид графа] [-s рёбер] [-q запросов] "
+                    "[-l меток] [-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    char path[] = "/tmp/reach_XXXXXX";
+    int fd = mkstemp(path);
+    FILE *f = fdopen(fd, "w");
+    gen_write(f, (GenKind)kind, edges, seed);
+    fclose(f);
+
+    Workspace ws = {0};
+    int edge_count = read_edges(path, &ws.edges, &ws.edge_capacity, NULL);
+    unlink(path);
+    int n = find_vertex_count(ws.edges, edge_count);
+    Graph g;
+    build_graph(&g, &ws, edge_count, n, STORAGE_SPARSE);
+
+    int *from = malloc(queries * sizeof(int));
+    int *to = malloc(queries * sizeof(int));
+    int *expected = malloc(queries * sizeof(int));
+    int *answers = malloc(queries * sizeof(int));
+    make_queries(&g, queries, seed + 1, from, to);
+
+    const char *kname = gen_kind_names[kind];
+    printf("kind,edges,vertices,index,build_sec,index_bytes,queries,qps,positives,mismatches\n");
+
+    // обход в глубину: без индекса, ответы служат эталоном
+    unsigned *stamp = calloc(n, sizeof(unsigned));
+    int *stack = malloc((size_t)(edge_count + 1) * sizeof(int));
+    int positives = 0;
+    double t0 = now_sec();
+    for (int i = 0; i < queries; ++i) {
+        expected[i] = dfs_reach(&g, from[i], to[i], stamp, (unsigned)i + 1, stack);
+        positives += expected[i];
+    }
+    report(kname, edges, n, "dfs", 0, 0, queries, now_sec() - t0, positives, 0);
+    free(stamp);
+    free(stack);
+
+    for (int kind_index = REACH_CLOSURE; kind_index <= REACH_GRAIL; ++kind_index) {
+        long long bytes = kind_index == REACH_CLOSURE
+            ? (long long)n * ((n + 63) / 64) * 8
+            : 2LL * labels * n * (long long)sizeof(int);
+        if (kind_index == REACH_CLOSURE && bytes > CLOSURE_LIMIT) {
+            printf("%s,%lld,%d,closure,skipped,%lld,,,,\n", kname, edges, n, bytes);
+            continue;
+        }
+
+        ReachIndex ri;
+        t0 = now_sec();
+        if (reach_build(&ri, &g, kind_index, labels) != 0) {
+            fprintf(stderr, "Граф содержит цикл\n");
+            return 1;
+        }
+        double build = now_sec() - t0;
+
+        t0 = now_sec();
+        reach_query_batch(&ri, from, to, queries, answers);
+        double seconds = now_sec() - t0;
+
+        int found = 0, mismatches = 0;
+        for (int i = 0; i < queries; ++i) {
+            found += answers[i];
+            mismatches += answers[i] != expected[i];
+        }
+        report(kname, edges, n, kind_index == REACH_CLOSURE ? "closure" : "grail", build, bytes,
+               queries, seconds, found, mismatches);
+        reach_free(&ri);
+    }
+
+    free(from);
+    free(to);
+    free(expected);
+    free(answers);
+    free_workspace(&ws);
+    return 0;
+}
@@ -0,0 +1,140 @@
+// бенчмарк перенумерации вершин lab1: стоимость перенумерации отдельно от
+// ускорения построения и сортировки, и размер сжатых строк при новой нумерации
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#define main lab_main
+#include "../lab1/prog.c"
+#undef main
+
+#include "gen.h"
+
+#define RELABEL_KIND_COUNT 4
+
+static const char *relabel_names[RELABEL_KIND_COUNT] = { "none", "bfs", "rcm", "degree" };
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// порядок в исходных номерах должен быть топологическим для исходных рёбер
+int check_order(const Edge *edges, int edge_count, int vertex_count, const int *order, int count,
+                const uint64_t *original) {
+    if (count != vertex_count)
+        return 0;   // граф с циклом: проверять нечего
+    int *pos = malloc(vertex_count * sizeof(int));
+    for (int i = 0; i < count; ++i)
+        pos[original ? (int)original[order[i]] : order[i]] = i;
+    int bad = 0;
+    for (int i = 0; i < edge_count; ++i)
+        bad += pos[edges[i].from] >= pos[edges[i].to];
+    free(pos);
+    return bad > 0;
+}
+
+int main(int argc, char **argv) {
+    long long edges = 10000000;
+    int repeats = 3;
+    const char *path = NULL;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:r:f:S:h")) != -1) {
+        switch (opt) {
+        case 's': edges = (long long)strtod(optarg, NULL); break;
+        case 'r': repeats = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'f': path = optarg; break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s [-s рёбер] [-r повторы] [-f файл] [-S seed]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    // порядок Тарьяна не нужен, только время
+    out.fd = open("/dev/null", O_WRONLY);
+
+    printf("kind,vertices,edges,order,relabel_sec,build_sec,kahn_sec,tarjan_sec,kahn_speedup,"
+           "tarjan_speedup,varint_bytes_per_edge,mismatches\n");
+    for (int kind = 0; kind < GEN_KIND_COUNT; ++kind) {
+        // с -f - один заданный граф
+        if (path && kind > 0)
+            break;
+        Edge *input = NULL;
+        int capacity = 0, count;
+        if (path) {
+            count = read_edges(path, &input, &capacity, NULL);
+        } else {
+            FILE *f = tmpfile();
+            gen_write(f, (GenKind)kind, edges, seed);
+            rewind(f);
+            count = read_edges_stream(f, &input, &capacity, NULL);
+            fclose(f);
+        }
+        if (count <= 0)
+            return 1;
+        int vertex_count = find_vertex_count(input, count);
+        const char *kname = path ? "file" : gen_kind_names[kind];
+        int *order = malloc(vertex_count * sizeof(int));
+        double base_kahn = 0, base_tarjan = 0;
+
+        for (int r = 0; r < RELABEL_KIND_COUNT; ++r) {
+            Workspace ws = {0};
+            ws.edges = malloc(count * sizeof(Edge));
+            ws.edge_capacity = count;
+            double relabel = -1, build = -1, kahn = -1, tarjan = -1;
+            uint64_t *original = NULL;
+            int ordered = 0;
+            Graph g;
+            for (int rep = 0; rep < repeats; ++rep) {
+                memcpy(ws.edges, input, count * sizeof(Edge));
+                free(original);
+                original = NULL;
+                double t0 = now_sec();
+                if (r != RELABEL_NONE) {
+                    int *new_of_old;
+                    original = relabel_edges(ws.edges, count, vertex_count, r, NULL, &new_of_old);
+                    free(new_of_old);
+                }
+                double t1 = now_sec();
+                build_graph(&g, &ws, count, vertex_count, STORAGE_SPARSE);
+                double t2 = now_sec();
+                ordered = kahn_order(&g, order);
+                double t3 = now_sec();
+                top_sort_tarjan(&g);
+                double t4 = now_sec();
+                if (relabel < 0 || t1 - t0 < relabel) relabel = t1 - t0;
+                if (build < 0 || t2 - t1 < build) build = t2 - t1;
+                if (kahn < 0 || t3 - t2 < kahn) kahn = t3 - t2;
+                if (tarjan < 0 || t4 - t3 < tarjan) tarjan = t4 - t3;
+            }
+            if (r == RELABEL_NONE) {
+                base_kahn = kahn;
+                base_tarjan = tarjan;
+            }
+            int mismatches = check_order(input, count, vertex_count, order, ordered, original);
+
+            // размер сжатых строк зависит от близости номеров соседей
+            build_graph(&g, &ws, count, vertex_count, STORAGE_VARINT);
+            double varint = (double)graph_bytes(&g) / count;
+
+            printf("%s,%d,%d,%s,%.4f,%.4f,%.4f,%.4f,%.2f,%.2f,%.2f,%d\n", kname, vertex_count,
+                   count, relabel_names[r], relabel, build, kahn, tarjan, base_kahn / kahn,
+                   base_tarjan / tarjan, varint, mismatches);
+            free(original);
+            free_workspace(&ws);
+        }
+        free(order);
+        free(input);
+    }
+    close(out.fd);
+    return 0;
+}
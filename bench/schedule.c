@@ -0,0 +1,163 @@
+// бенчмарк расписания lab1 (-S): раннее начало, критический путь и резерв в
+// проходе Кана против отдельных проходов по готовому порядку, время
+// моделирования исполнителей
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#define main lab_main
+#include "../lab1/prog.c"
+#undef main
+
+#include "gen.h"
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// как было до -S: порядок Кана, затем прямой проход за ранним началом и
+// обратный за резервом; возвращает длину критического пути
+long long separate_passes(const Graph *g, const int *duration, int *order, long long **start_out,
+                          long long **slack_out) {
+    int n = g->vertex_count;
+    int count = kahn_order(g, order);
+    long long *start = *start_out = calloc(n, sizeof(long long));
+    long long *slack = *slack_out = calloc(n, sizeof(long long));
+    long long length = 0;
+    for (int i = 0; i < count; ++i) {
+        int u = order[i];
+        long long finish = start[u] + duration[u];
+        if (finish > length)
+            length = finish;
+        SuccIter it;
+        succ_begin(g, u, &it);
+        for (int v = succ_next(g, u, &it); v >= 0; v = succ_next(g, u, &it)) {
+            long long t = finish + succ_weight(g, &it);
+            if (t > start[v])
+                start[v] = t;
+        }
+    }
+    for (int i = count - 1; i >= 0; --i) {
+        int u = order[i];
+        long long latest = length;
+        SuccIter it;
+        succ_begin(g, u, &it);
+        for (int v = succ_next(g, u, &it); v >= 0; v = succ_next(g, u, &it)) {
+            long long t = slack[v] - succ_weight(g, &it);
+            if (t < latest)
+                latest = t;
+        }
+        slack[u] = latest - duration[u];
+    }
+    for (int u = 0; u < n; ++u)
+        slack[u] -= start[u];
+    return length;
+}
+
+int main(int argc, char **argv) {
+    long long edges = 10000000;
+    int repeats = 3;
+    int workers = 16;
+    const char *path = NULL;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:r:p:f:S:h")) != -1) {
+        switch (opt) {
+        case 's': edges = (long long)strtod(optarg, NULL); break;
+        case 'r': repeats = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'p': workers = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'f': path = optarg; break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s [-s рёбер] [-r повторы] [-p исполнителей] "
+                    "[-f файл] [-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("kind,vertices,edges,critical_path,levels,max_width,separate_sec,fused_sec,speedup,"
+           "workers,makespan,simulate_sec,mismatches\n");
+    for (int kind = 0; kind < GEN_KIND_COUNT; ++kind) {
+        // с -f - один заданный граф; у графа с циклом расписания нет
+        if (path && kind > 0)
+            break;
+        if (!path && kind == GEN_CYCLIC)
+            continue;
+        Workspace ws = {0};
+        int count;
+        schedule = 1;
+        if (path) {
+            count = read_edges(path, &ws.edges, &ws.edge_capacity, NULL);
+        } else {
+            FILE *f = tmpfile();
+            gen_write(f, (GenKind)kind, edges, seed);
+            rewind(f);
+            count = read_edges_stream(f, &ws.edges, &ws.edge_capacity, NULL);
+            fclose(f);
+        }
+        if (count <= 0)
+            return 1;
+        int vertex_count = find_vertex_count(ws.edges, count);
+        count = split_durations(&ws, count, vertex_count);
+
+        // у сгенерированного графа веса случайные: длительности 1..100, задержки 0..9
+        unsigned long long state = seed;
+        if (!path) {
+            for (int v = 0; v < vertex_count; ++v)
+                ws.durations[v] = 1 + (int)gen_range(&state, 100);
+            for (int i = 0; i < count; ++i)
+                ws.edges[i].weight = (int)gen_range(&state, 10);
+            ws.weighted = 1;
+        }
+        Graph g;
+        if (build_graph(&g, &ws, count, vertex_count, STORAGE_SPARSE) != 0)
+            return 1;
+        const char *kname = path ? "file" : gen_kind_names[kind];
+
+        int *order = malloc(vertex_count * sizeof(int));
+        long long *start = NULL, *slack = NULL;
+        long long length = 0;
+        double separate = -1, fused = -1, simulate = -1;
+        Schedule s = {0};
+        long long makespan = 0;
+        for (int r = 0; r < repeats; ++r) {
+            free(start);
+            free(slack);
+            scratch_free(s.node);
+            scratch_free(s.slack);
+            double t0 = now_sec();
+            length = separate_passes(&g, ws.durations, order, &start, &slack);
+            double t1 = now_sec();
+            kahn_schedule(&g, ws.durations, order, &s);
+            double t2 = now_sec();
+            makespan = schedule_makespan(&g, ws.durations, &s, workers);
+            double t3 = now_sec();
+            if (separate < 0 || t1 - t0 < separate) separate = t1 - t0;
+            if (fused < 0 || t2 - t1 < fused) fused = t2 - t1;
+            if (simulate < 0 || t3 - t2 < simulate) simulate = t3 - t2;
+        }
+        // раннее начало и резерв отдельных проходов служат эталоном
+        int mismatches = s.length != length
+                         || memcmp(slack, s.slack, vertex_count * sizeof(long long)) != 0;
+        for (int v = 0; v < vertex_count; ++v)
+            mismatches += start[v] != s.node[v].start;
+
+        printf("%s,%d,%d,%lld,%d,%d,%.4f,%.4f,%.2f,%d,%lld,%.4f,%d\n", kname, vertex_count, count,
+               s.length, s.levels, s.max_width, separate, fused, separate / fused, workers,
+               makespan, simulate, mismatches);
+        scratch_free(s.node);
+        scratch_free(s.slack);
+        free(order);
+        free(start);
+        free(slack);
+        free_workspace(&ws);
+    }
+    return 0;
+}
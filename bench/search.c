@@ -0,0 +1,128 @@
+// бенчмарк поиска подстроки lab4 на худших для Бойера-Мура периодических текстах:
+// подсчёт всех вхождений обычным Бойером-Муром и Turbo-BM
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+// счётчик сравнений нужен в отчёте
+#define STATS
+#define main lab_main
+#include "../lab4/main.c"
+#undef main
+
+#include "gen.h"
+
+typedef enum { TEXT_ONES, TEXT_PERIOD, TEXT_ORDER, TEXT_KIND_COUNT } TextKind;
+
+static const char *text_kind_names[TEXT_KIND_COUNT] = { "ones", "period", "order" };
+
+// ones - "1 1 1 ...", шаблон из тех же единиц: вхождение на каждом втором символе;
+// period - повтор "12 3 ", шаблон - его начало длины m, вхождение на каждом пятом;
+// order - случайная перестановка, шаблон - последние три числа, одно вхождение
+char *make_text(TextKind kind, int n, int m, unsigned long long seed, char **pattern) {
+    char *text = malloc((size_t)n + 12);
+    int len = 0;
+    if (kind == TEXT_ORDER) {
+        unsigned long long state = seed;
+        int count = n / 7 > 3 ? n / 7 : 3;
+        int *perm = gen_permutation(count, &state);
+        for (int i = 0; i < count && len < n; ++i)
+            len += sprintf(text + len, i ? " %d" : "%d", perm[i]);
+        free(perm);
+        text[len] = '\0';
+        // три последних числа
+        char *p = text + len;
+        for (int spaces = 0; p > text; --p)
+            if (p[-1] == ' ' && ++spaces == 3)
+                break;
+        *pattern = strdup(p);
+        return text;
+    }
+
+    const char *unit = kind == TEXT_ONES ? "1 " : "12 3 ";
+    int unit_len = strlen(unit);
+    for (len = 0; len < n; ++len)
+        text[len] = unit[len % unit_len];
+    text[len] = '\0';
+    *pattern = malloc(m + 1);
+    memcpy(*pattern, text, m);
+    (*pattern)[m] = '\0';
+    return text;
+}
+
+int main(int argc, char **argv) {
+    int n = 10000000;
+    int lengths[16] = { 8, 64, 512 };
+    int length_count = 3;
+    int repeats = 3;
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:m:r:S:h")) != -1) {
+        char *list, *tok;
+        switch (opt) {
+        case 'n': n = (int)strtod(optarg, NULL); break;
+        case 'm':
+            length_count = 0;
+            list = strdup(optarg);
+            for (tok = strtok(list, ","); tok && length_count < 16; tok = strtok(NULL, ","))
+                lengths[length_count++] = atoi(tok);
+            free(list);
+            break;
+        case 'r': repeats = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s [-n длина текста] [-m длины шаблона] "
+                    "[-r повторы] [-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    static const char *algo_names[2] = { "bm", "turbo" };
+    SearchFn algos[2] = { boyer_moore_search, turbo_bm_search };
+
+    printf("text,text_len,pattern_len,algorithm,best_sec,mb_per_sec,matches,comparisons,"
+           "comparisons_per_char,mismatches\n");
+    for (int kind = 0; kind < TEXT_KIND_COUNT; ++kind) {
+        for (int l = 0; l < length_count; ++l) {
+            // у случайного порядка длина шаблона определяется текстом
+            if (kind == TEXT_ORDER && l > 0)
+                break;
+            char *pattern;
+            char *text = make_text((TextKind)kind, n, lengths[l], seed, &pattern);
+            int text_len = strlen(text);
+            long long expected = -1;
+            int expected_pos = -1;
+
+            for (int a = 0; a < 2; ++a) {
+                double best = -1;
+                long long matches = 0, comparisons = 0;
+                int pos = -1;
+                for (int r = 0; r < repeats; ++r) {
+                    stats.bm_comparisons = 0;
+                    double t0 = stats_now();
+                    pos = algos[a](text, pattern, &matches);
+                    double t = stats_now() - t0;
+                    if (best < 0 || t < best) best = t;
+                    comparisons = stats.bm_comparisons;
+                }
+                // обычный Бойер-Мур служит эталоном
+                if (a == 0) {
+                    expected = matches;
+                    expected_pos = pos;
+                }
+                printf("%s,%d,%d,%s,%.6f,%.1f,%lld,%lld,%.3f,%d\n", text_kind_names[kind],
+                       text_len, (int)strlen(pattern), algo_names[a], best,
+                       best > 0 ? text_len / best / 1e6 : 0, matches, comparisons,
+                       (double)comparisons / text_len,
+                       matches != expected || pos != expected_pos);
+            }
+            free(pattern);
+            free(text);
+        }
+    }
+    return 0;
+}
@@ -1,4 +1,18 @@
-from typing import Tuple
+from __future__ import annotations
+
+import argparse
+import math
+import sys
+import time
+from typing import TYPE_CHECKING, Callable, List, Tuple
+
+# numpy нужен только пакетным функциям и импортируется в них: одиночное
+# уравнение, --mode и --compare работают без него
+if TYPE_CHECKING:
+    import numpy as np
+
+# число шагов каждого метода с последнего сброса, для сравнения режимов
+iteration_counts = {"combined": 0, "closed_form": 0}
 
 
 def user_input() -> Tuple[float, float, float, float]:
@@ -71,6 +85,7 @@ def combined_method(
 ) -> float:
     """Комбинированный метод хорд и касательных для кубического уравнения"""
     while abs(start - end) > e:
+        iteration_counts["combined"] += 1
         if f(start, a, b, c, d) * d2f(start, a, b) <= 0 and valid_df(end, a, b, c):
             start = chord(a, b, c, d, start, end)
         else:
@@ -83,6 +98,70 @@ def combined_method(
     return round_to_precision((start + end) / 2, e)
 
 
+def closed_form_roots(a: float, b: float, c: float, d: float) -> List[float]:
+    """Вещественные корни по формуле Кардано (один корень) или тригонометрической
+    формуле (три корня) для приведённого уравнения t^3 + pt + q = 0, x = t - b / 3a
+    """
+    shift = b / (3 * a)
+    p = (3 * a * c - b**2) / (3 * a**2)
+    q = (2 * b**3 - 9 * a * b * c + 27 * a**2 * d) / (27 * a**3)
+    disc = (q / 2) ** 2 + (p / 3) ** 3
+
+    if p == 0 and q == 0:
+        return [-shift]
+    if disc > 0:
+        # выбор знака без вычитания близких чисел
+        u = -q / 2 - math.copysign(math.sqrt(disc), q)
+        u = math.copysign(abs(u) ** (1 / 3), u)
+        return [u - p / (3 * u) - shift]
+
+    r = 2 * math.sqrt(-p / 3)
+    phi = math.acos(max(-1.0, min(1.0, 3 * q / (p * r))))
+    return [r * math.cos((phi - 2 * math.pi * k) / 3) - shift for k in range(3)]
+
+
+def closed_form_method(
+    start: float, end: float, e: float, a: float, b: float, c: float, d: float
+) -> float:
+    """Корень на отрезке [start, end] со сменой знака: начальное приближение из
+    closed_form_roots, затем шаги Галлея до полной точности double. Отрезок сужается
+    по знаку f на каждом шаге; шаг, уходящий за отрезок (почти кратный корень,
+    нулевая производная), заменяется делением пополам
+    """
+    lo, hi = min(start, end), max(start, end)
+    f_lo = f(lo, a, b, c, d)
+    if f_lo == 0:
+        return round_to_precision(lo, e)
+
+    seeds = [x for x in closed_form_roots(a, b, c, d) if lo <= x <= hi]
+    x = seeds[0] if seeds else (lo + hi) / 2
+
+    for _ in range(200):
+        iteration_counts["closed_form"] += 1
+        fx = f(x, a, b, c, d)
+        if fx == 0:
+            break
+        if (fx < 0) == (f_lo < 0):
+            lo, f_lo = x, fx
+        else:
+            hi = x
+
+        d1 = df(x, a, b, c)
+        denom = 2 * d1 * d1 - fx * d2f(x, a, b)
+        x_new = x - 2 * fx * d1 / denom if denom != 0 else lo - 1
+        if not lo < x_new < hi:
+            x_new = (lo + hi) / 2
+        if abs(x_new - x) <= 4 * sys.float_info.epsilon * max(1.0, abs(x)):
+            x = x_new
+            break
+        x = x_new
+    return round_to_precision(x, e)
+
+
+# режимы поиска корня на отрезке: метод и его название в iteration_counts
+METHODS = {"combined": combined_method, "closed_form": closed_form_method}
+
+
 def non_cubic_solver(e: float, b: float, c: float, d: float) -> None:
     """Решает линейное или квадратное уравнение"""
     if b == 0:
@@ -106,8 +185,13 @@ def non_cubic_solver(e: float, b: float, c: float, d: float) -> None:
                   f"x2 = {round_to_precision(x2, e)}")
 
 
-def cubic_solver(e: float, a: float, b: float, c: float, d: float) -> None:
-    """Решает кубическое уравнение"""
+def cubic_roots(
+    e: float, a: float, b: float, c: float, d: float,
+    method: Callable[..., float] = combined_method
+) -> List[float]:
+    """Находит вещественные корни кубического уравнения по возрастанию номера x1, x2, x3;
+    method ищет корень на отрезке со сменой знака
+    """
     mmax = 1 + max(abs(a), abs(b), abs(c), abs(d)) / abs(a)
     mmin = -mmax
     infl_point = -b / (3 * a)
@@ -115,58 +199,203 @@ def cubic_solver(e: float, a: float, b: float, c: float, d: float) -> None:
 
     if disc <= 0:
         if f(infl_point, a, b, c, d) * a > 0:
-            x = combined_method(mmin, infl_point, e, a, b, c, d)
+            x = method(mmin, infl_point, e, a, b, c, d)
         elif f(infl_point, a, b, c, d) * a < 0:
-            x = combined_method(infl_point, mmax, e, a, b, c, d)
+            x = method(infl_point, mmax, e, a, b, c, d)
         else:
             x = infl_point
-        print(f"Решение: x = {round_to_precision(x, e)}")
-    else:
-        # поиск экстремумов
-        ex1 = (-2 * b - disc**0.5) / (6 * a)
-        ex2 = (-2 * b + disc**0.5) / (6 * a)
-        min_point = min(ex1, ex2)
-        max_point = max(ex1, ex2)
-
-        if f(min_point, a, b, c, d) * f(max_point, a, b, c, d) > 0:
-            if f(infl_point, a, b, c, d) * a > 0:
-                x = combined_method(mmin, min_point, e, a, b, c, d)
-            else:
-                x = combined_method(max_point, mmax, e, a, b, c, d)
-            print(f"Решение: x = {round_to_precision(x, e)}")
+        return [x]
 
-        elif f(min_point, a, b, c, d) * f(max_point, a, b, c, d) == 0:
-            if f(infl_point, a, b, c, d) * a > 0:
-                x1 = combined_method(mmin, min_point, e, a, b, c, d)
-                x2 = max_point
-            else:
-                x1 = combined_method(max_point, mmax, e, a, b, c, d)
-                x2 = min_point
-            print(f"Решение: x1 = {round_to_precision(x1, e)}, "
-                  f"x2 = {round_to_precision(x2, e)}")
+    # поиск экстремумов
+    ex1 = (-2 * b - disc**0.5) / (6 * a)
+    ex2 = (-2 * b + disc**0.5) / (6 * a)
+    min_point = min(ex1, ex2)
+    max_point = max(ex1, ex2)
 
+    if f(min_point, a, b, c, d) * f(max_point, a, b, c, d) > 0:
+        if f(infl_point, a, b, c, d) * a > 0:
+            x = method(mmin, min_point, e, a, b, c, d)
         else:
-            x1 = combined_method(mmin, min_point, e, a, b, c, d)
-            x3 = combined_method(max_point, mmax, e, a, b, c, d)
-            if f(infl_point, a, b, c, d) * a == 0:
-                x2 = infl_point
-            elif f(infl_point, a, b, c, d) * a > 0:
-                x2 = combined_method(infl_point, max_point, e, a, b, c, d)
-            else:
-                x2 = combined_method(min_point, infl_point, e, a, b, c, d)
-            print(f"Решение: x1 = {round_to_precision(x1, e)}, "
-                  f"x2 = {round_to_precision(x2, e)}, "
-                  f"x3 = {round_to_precision(x3, e)}")
+            x = method(max_point, mmax, e, a, b, c, d)
+        return [x]
+
+    if f(min_point, a, b, c, d) * f(max_point, a, b, c, d) == 0:
+        if f(infl_point, a, b, c, d) * a > 0:
+            x1 = method(mmin, min_point, e, a, b, c, d)
+            x2 = max_point
+        else:
+            x1 = method(max_point, mmax, e, a, b, c, d)
+            x2 = min_point
+        return [x1, x2]
+
+    x1 = method(mmin, min_point, e, a, b, c, d)
+    x3 = method(max_point, mmax, e, a, b, c, d)
+    if f(infl_point, a, b, c, d) * a == 0:
+        x2 = infl_point
+    elif f(infl_point, a, b, c, d) * a > 0:
+        x2 = method(infl_point, max_point, e, a, b, c, d)
+    else:
+        x2 = method(min_point, infl_point, e, a, b, c, d)
+    return [x1, x2, x3]
+
+
+def cubic_solver(
+    e: float, a: float, b: float, c: float, d: float,
+    method: Callable[..., float] = combined_method
+) -> None:
+    """Решает кубическое уравнение"""
+    roots = cubic_roots(e, a, b, c, d, method)
+    if len(roots) == 1:
+        print(f"Решение: x = {round_to_precision(roots[0], e)}")
+    else:
+        print("Решение: " + ", ".join(
+            f"x{i + 1} = {round_to_precision(x, e)}" for i, x in enumerate(roots)))
+
+
+def combined_method_batch(
+    start: np.ndarray, end: np.ndarray, e: float,
+    a: np.ndarray, b: np.ndarray, c: np.ndarray, d: np.ndarray, max_iter: int = 200
+) -> np.ndarray:
+    """Комбинированный метод хорд и касательных для массива отрезков:
+    шаг выполняется масками сразу для всех отрезков, итерируются только несошедшиеся.
+    Значения многочлена считаются по схеме Горнера и переиспользуются внутри шага;
+    шаг, вырожденный в 0/0 (почти сошедшийся отрезок или нулевая производная),
+    заменяется серединой отрезка; не больше max_iter шагов
+    """
+    import numpy as np
+
+    start = np.array(start, dtype=float)
+    end = np.array(end, dtype=float)
+    active = np.flatnonzero(np.abs(start - end) > e)
+
+    with np.errstate(divide="ignore", invalid="ignore", over="ignore"):
+        for _ in range(max_iter):
+            if not active.size:
+                break
+            s, t = start[active], end[active]
+            ka, kb, kc, kd = a[active], b[active], c[active], d[active]
+            fs = ((ka * s + kb) * s + kc) * s + kd
+            ft = ((ka * t + kb) * t + kc) * t + kd
+            dfs = (3 * ka * s + 2 * kb) * s + kc
+            dft = (3 * ka * t + 2 * kb) * t + kc
+
+            use_chord = (fs * (6 * ka * s + 2 * kb) <= 0) & (np.abs(dft) > 1e-15)
+            s_new = np.where(use_chord, s - fs / (ft - fs) * (t - s), s - fs / dfs)
+            s_new = np.where(np.isfinite(s_new), s_new, (s + t) / 2)
+
+            fs_new = ((ka * s_new + kb) * s_new + kc) * s_new + kd
+            dfs_new = (3 * ka * s_new + 2 * kb) * s_new + kc
+            use_chord = (ft * (6 * ka * t + 2 * kb) <= 0) & (np.abs(dfs_new) > 1e-15)
+            t_new = np.where(use_chord, t - ft / (fs_new - ft) * (s_new - t), t - ft / dft)
+            t_new = np.where(np.isfinite(t_new), t_new, (s_new + t) / 2)
+
+            start[active], end[active] = s_new, t_new
+            active = active[np.abs(s_new - t_new) > e]
+
+    return (start + end) / 2
+
+
+def cubic_solver_batch(
+    e: float, a: np.ndarray, b: np.ndarray, c: np.ndarray, d: np.ndarray
+) -> Tuple[np.ndarray, np.ndarray]:
+    """Решает массив кубических уравнений (a != 0) с общей точностью e.
+    Возвращает корни формы (n, 3), как x1, x2, x3 в cubic_roots (отсутствующие - nan),
+    и число корней каждого уравнения
+    """
+    import numpy as np
+
+    a, b, c, d = (np.asarray(v, dtype=float) for v in (a, b, c, d))
+    n = a.size
+    roots = np.full((n, 3), np.nan)
+    count = np.ones(n, dtype=int)
+
+    mmax = 1 + np.maximum.reduce([np.abs(a), np.abs(b), np.abs(c), np.abs(d)]) / np.abs(a)
+    mmin = -mmax
+    infl_point = -b / (3 * a)
+    disc = 4 * b**2 - 12 * a * c
+    fi = f(infl_point, a, b, c, d) * a
+
+    with np.errstate(invalid="ignore"):
+        sq = np.sqrt(disc)
+    ex1 = (-2 * b - sq) / (6 * a)
+    ex2 = (-2 * b + sq) / (6 * a)
+    min_point = np.minimum(ex1, ex2)
+    max_point = np.maximum(ex1, ex2)
+    ext = f(min_point, a, b, c, d) * f(max_point, a, b, c, d)
+
+    # классификация по дискриминанту производной и значениям в экстремумах
+    one = disc <= 0
+    single = ~one & (ext > 0)
+    double = ~one & (ext == 0)
+    triple = ~one & (ext < 0)
+    count[double] = 2
+    count[triple] = 3
+
+    # отрезки для метода: (уравнение, номер корня, начало, конец)
+    lanes, slots, starts, ends = [], [], [], []
+
+    def task(mask: np.ndarray, slot: int, st: np.ndarray, en: np.ndarray) -> None:
+        idx = np.flatnonzero(mask)
+        lanes.append(idx)
+        slots.append(np.full(idx.size, slot))
+        starts.append(st[idx])
+        ends.append(en[idx])
+
+    task(one & (fi > 0), 0, mmin, infl_point)
+    task(one & (fi < 0), 0, infl_point, mmax)
+    roots[one & (fi == 0), 0] = infl_point[one & (fi == 0)]
+
+    task(single & (fi > 0), 0, mmin, min_point)
+    task(single & (fi <= 0), 0, max_point, mmax)
+
+    task(double & (fi > 0), 0, mmin, min_point)
+    roots[double & (fi > 0), 1] = max_point[double & (fi > 0)]
+    task(double & (fi <= 0), 0, max_point, mmax)
+    roots[double & (fi <= 0), 1] = min_point[double & (fi <= 0)]
+
+    task(triple, 0, mmin, min_point)
+    task(triple, 2, max_point, mmax)
+    roots[triple & (fi == 0), 1] = infl_point[triple & (fi == 0)]
+    task(triple & (fi > 0), 1, infl_point, max_point)
+    task(triple & (fi < 0), 1, min_point, infl_point)
+
+    lane = np.concatenate(lanes)
+    slot = np.concatenate(slots)
+    x = combined_method_batch(np.concatenate(starts), np.concatenate(ends), e,
+                              a[lane], b[lane], c[lane], d[lane])
+    roots[lane, slot] = np.round(x, abs(int(f"{e:e}".split("e")[-1])))
+    return roots, count
+
+
+def compare_methods(e: float, a: float, b: float, c: float, d: float) -> None:
+    """Решает уравнение каждым режимом и выводит число шагов и время"""
+    for name, method in METHODS.items():
+        iteration_counts[name] = 0
+        t0 = time.perf_counter()
+        roots = cubic_roots(e, a, b, c, d, method)
+        elapsed = time.perf_counter() - t0
+        print(f"{name}: " + ", ".join(str(round_to_precision(x, e)) for x in roots)
+              + f"; шагов: {iteration_counts[name]}, время: {elapsed * 1e6:.1f} мкс")
 
 
 def main() -> None:
+    parser = argparse.ArgumentParser(description="Решение кубического уравнения")
+    parser.add_argument("--mode", choices=list(METHODS), default="combined",
+                        help="combined - метод хорд и касательных, closed_form - формула "
+                             "Кардано с уточнением методом Галлея")
+    parser.add_argument("--compare", action="store_true",
+                        help="решить всеми режимами и вывести число шагов и время")
+    args = parser.parse_args()
+
     a, b, c, d = user_input()
     e = get_precision()
 
     if a == 0:
         non_cubic_solver(e, b, c, d)
+    elif args.compare:
+        compare_methods(e, a, b, c, d)
     else:
-        cubic_solver(e, a, b, c, d)
+        cubic_solver(e, a, b, c, d, METHODS[args.mode])
 
 if __name__ == "__main__":
     main()
@@ -1,14 +1,1192 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <linux/mempolicy.h>
+#endif
 
 #define MAX_VERTICES 100
-#define MAX_EDGES 1000
+#define STORAGE_STATIC 1
+#define STORAGE_DYNAMIC 2
+#define STORAGE_BITSET 3
+#define STORAGE_SPARSE 4
+#define STORAGE_VARINT 5
+#define VARINT_BLOCK 8          // Вершин сжатого графа на одно хранимое смещение
+#define INITIAL_EDGES 1024
+#define INITIAL_IDS 1024
+#define OUT_BUF_SIZE (1 << 20)
+#define PRIORITY_LEX 1          // Наименьший номер вершины первым
+#define PRIORITY_CRITICAL 2     // Наибольшая длина пути до стока первой
+#define PRIORITY_FILE 3         // Приоритеты из файла, наибольший первым
+#define BUCKET_RANGE 4096       // Предел разброса приоритетов для очереди по корзинам
+#define REACH_AUTO 0            // Замыкание, если помещается в лимит, иначе метки
+#define REACH_CLOSURE 1         // Битовое транзитивное замыкание: V * V / 8 байт
+#define REACH_GRAIL 2           // Интервальные метки с дообходом: 2k int на вершину
+#define GRAIL_LABELS 5
+#define CLOSURE_LIMIT (1LL << 31)   // Предел памяти замыкания в байтах
+#define EXTERNAL_MIN_BUDGET (1 << 20)
+#define CACHE_DEFAULT_LIMIT (256LL << 20)
+#define RELABEL_NONE 0
+#define RELABEL_BFS 1           // Обход в ширину без учёта направления рёбер
+#define RELABEL_RCM 2           // Обратный Катхилл-Макки: обход от вершин наименьшей степени
+#define RELABEL_DEGREE 3        // По убыванию степени: вершины-хабы рядом в начале
+#define INGEST_STDIO 0          // fgets и sscanf по строке
+#define INGEST_THREAD 1         // Поток чтения и два буфера
+#define INGEST_URING 2          // Несколько чтений в полёте через io_uring
+#define INGEST_BLOCK (1 << 20)
+#define INGEST_DEPTH 4
+#define RADIX_BITS 11           // Наибольшая цифра ключа ребра: 2048 корзин на проход
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define DEDUP_MIN_CHUNK (1 << 16)   // Меньше рёбер на поток - сортирует меньше потоков
+#define PAGES_DEFAULT 0         // malloc, как раньше
+#define PAGES_THP 1             // Своё отображение с madvise(MADV_HUGEPAGE)
+#define PAGES_HUGETLB 2         // MAP_HUGETLB; без свободных страниц - как THP
+#define NUMA_DEFAULT 0
+#define NUMA_INTERLEAVE 1       // Страницы по очереди на всех узлах
+#define NUMA_LOCAL 2            // Страница на узле потока, который первым её пишет
+#define HUGE_PAGE ((size_t)2 << 20)
+#define BIG_MIN HUGE_PAGE       // Меньшие массивы всегда из malloc
+#define MAX_NODES 64
+#define DAEMON_TIMEOUT 30       // Секунд ожидания сервером данных клиента или места в сокете
 
+// Строка "v = d" (длительность вершины) хранится среди рёбер как {v, -1, d}
 typedef struct {
     int from;
     int to;
+    int weight;     // Задержка между концом from и началом to, 0 - не задана
 } Edge;
 
+typedef enum { OUT_TEXT, OUT_BINARY, OUT_BINARY64 } OutFormat;
+
+// буферизованный вывод результата: один write на блок
+typedef struct {
+    int fd;
+    OutFormat format;
+    int framed;     // пакетный двоичный режим: перед порядком пишется его длина
+    int tee;        // копия вывода для кэша результатов, -1 - нет
+    size_t len;
+    char *buf;      // OUT_BUF_SIZE байт, выделяется при первой записи
+    int cycle;      // с последнего cache_begin выведено сообщение о цикле
+} OutWriter;
+
+// У каждого потока сервера свой вывод в сокет клиента. В TLS только
+// заголовок: потоки чтения и сортировки ничего не выводят, и буфер у них
+// не выделяется
+_Thread_local OutWriter out = { 1, OUT_TEXT, 0, -1, 0, NULL, 0 };
+
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// сброс буфера в файл и в копию для кэша
+void out_flush(OutWriter *w) {
+    if (w->fd == 1)
+        fflush(stdout); // сохраняем порядок с printf
+    int fds[2] = { w->fd, w->tee };
+    for (int i = 0; i < 2 && fds[i] >= 0; ++i) {
+        size_t done = 0;
+        while (done < w->len) {
+            ssize_t n = write(fds[i], w->buf + done, w->len - done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                perror("Ошибка записи результата");
+                // Истёк таймаут сокета сервера: клиент не читает, остаток ответа не пишем
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    w->fd = -1;
+                break;
+            }
+            done += (size_t)n;
+        }
+    }
+    w->len = 0;
+}
+
+// буфер вывода нужен только перед первой записью
+static inline void out_reserve(OutWriter *w) {
+    if (!w->buf)
+        w->buf = malloc(OUT_BUF_SIZE);
+}
+
+// вывод строки (только в текстовом режиме)
+void out_str(OutWriter *w, const char *s) {
+    if (w->format != OUT_TEXT) return;
+    out_reserve(w);
+    size_t n = strlen(s);
+    while (n > 0) {
+        if (w->len == OUT_BUF_SIZE)
+            out_flush(w);
+        size_t chunk = OUT_BUF_SIZE - w->len;
+        if (chunk > n) chunk = n;
+        memcpy(w->buf + w->len, s, chunk);
+        w->len += chunk;
+        s += chunk;
+        n -= chunk;
+    }
+}
+
+// вывод беззнакового числа текстом через пробел или в двоичном формате
+void out_u64(OutWriter *w, uint64_t u, int negative) {
+    out_reserve(w);
+    if (w->len + 24 > OUT_BUF_SIZE)
+        out_flush(w);
+    char *p = w->buf + w->len;
+
+    if (w->format != OUT_TEXT) {
+        // int32 или int64 little-endian
+        int bytes = w->format == OUT_BINARY64 ? 8 : 4;
+        uint64_t x = negative ? 0 - u : u;
+        for (int i = 0; i < bytes; ++i)
+            p[i] = (char)((x >> (8 * i)) & 0xff);
+        w->len += bytes;
+        return;
+    }
+
+    char tmp[24];
+    int i = sizeof(tmp);
+    while (u >= 100) {
+        int d = (int)(u % 100) * 2;
+        u /= 100;
+        tmp[--i] = digit_pairs[d + 1];
+        tmp[--i] = digit_pairs[d];
+    }
+    if (u >= 10) {
+        int d = (int)u * 2;
+        tmp[--i] = digit_pairs[d + 1];
+        tmp[--i] = digit_pairs[d];
+    } else {
+        tmp[--i] = (char)('0' + u);
+    }
+    if (negative)
+        tmp[--i] = '-';
+
+    int n = sizeof(tmp) - i;
+    memcpy(p, tmp + i, n);
+    p[n] = ' ';
+    w->len += n + 1;
+}
+
+// вывод числа: текстом через пробел или как int32/int64 little-endian
+void out_int(OutWriter *w, long long x) {
+    if (x < 0)
+        out_u64(w, 0ULL - (unsigned long long)x, 1);
+    else
+        out_u64(w, (uint64_t)x, 0);
+}
+
+// начало результата: заголовок в текстовом режиме, длина в пакетном двоичном
+void out_begin(OutWriter *w, const char *title, int count) {
+    if (w->format == OUT_TEXT)
+        out_str(w, title);
+    else if (w->framed)
+        out_int(w, count);
+}
+
+// сообщение о цикле: в двоичном пакетном режиме - длина -1
+void out_cycle(OutWriter *w) {
+    w->cycle = 1;
+    if (w->format == OUT_TEXT) {
+        out_str(w, "Граф содержит цикл\n");
+        out_flush(w);
+    } else if (w->framed) {
+        out_int(w, -1);
+    } else {
+        fprintf(stderr, "Граф содержит цикл\n");
+    }
+}
+
+// завершение блока результата
+void out_end(OutWriter *w) {
+    out_str(w, "\n");
+    out_flush(w);
+}
+
+// Большие массивы (рёбра, CSR, матрица, in_degree, очереди, результат)
+// выделяются через big_alloc. По умолчанию это обычный malloc. С -H массив
+// получает свой mmap с большими страницами: thp - madvise(MADV_HUGEPAGE),
+// huge - MAP_HUGETLB, а без свободных страниц hugetlb - как thp. С -N
+// страницы кладутся на узлы NUMA по очереди (interleave) или на узел потока,
+// который первым их пишет (local)
+int page_mode = PAGES_DEFAULT;
+int numa_mode = NUMA_DEFAULT;
+int memory_report = 0;      // -M: сводка по страницам и узлам в stderr
+
+typedef struct {
+    char *p;
+    size_t bytes;
+    size_t len;         // Длина отображения; 0 - массив из malloc
+    int kind;           // PAGES_DEFAULT, PAGES_THP или PAGES_HUGETLB
+} BigBlock;
+
+// Сводка -M: резидентные байты каждого массива считаются при освобождении
+typedef struct {
+    int allocations;
+    int hugetlb_fallbacks;
+    int mbind_failures;
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t page_bytes[3];       // 4 КБ, THP, hugetlb
+    size_t node_bytes[MAX_NODES];
+    int nodes_known;
+} MemStats;
+
+static BigBlock *big_blocks = NULL;
+static int big_block_count = 0;
+static int big_block_capacity = 0;
+static MemStats mem_stats;
+static pthread_mutex_t big_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Маска узлов из /sys/devices/system/node/online ("0-1,3"); 0 - узлы неизвестны
+static unsigned long numa_node_mask(void) {
+    static unsigned long mask = 0;
+    static int loaded = 0;
+    if (loaded)
+        return mask;
+    loaded = 1;
+    FILE *f = fopen("/sys/devices/system/node/online", "r");
+    if (!f)
+        return mask;
+    int a, b;
+    char sep;
+    while (fscanf(f, "%d", &a) == 1) {
+        b = a;
+        if (fscanf(f, "%c", &sep) == 1 && sep == '-' && fscanf(f, "%d", &b) == 1)
+            sep = fgetc(f);
+        for (int n = a; n <= b && n < MAX_NODES; ++n)
+            mask |= 1UL << n;
+        if (sep != ',')
+            break;
+    }
+    fclose(f);
+    return mask;
+}
+
+static void numa_place(char *p, size_t len) {
+#ifdef __linux__
+    unsigned long mask = numa_node_mask();
+    long rc = numa_mode == NUMA_INTERLEAVE
+        ? syscall(SYS_mbind, p, len, MPOL_INTERLEAVE, &mask, MAX_NODES + 1, 0)
+        : syscall(SYS_mbind, p, len, MPOL_LOCAL, NULL, 0, 0);
+    if (rc != 0)
+        mem_stats.mbind_failures++;
+#else
+    (void)p;
+    (void)len;
+    mem_stats.mbind_failures++;
+#endif
+}
+
+// Отдельное отображение, выровненное на большую страницу
+static char *big_map(size_t len, int *kind) {
+    char *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (*kind == PAGES_HUGETLB) {
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                 -1, 0);
+        if (p == MAP_FAILED) {
+            mem_stats.hugetlb_fallbacks++;
+            *kind = PAGES_THP;
+        }
+    }
+#endif
+    if (p == MAP_FAILED) {
+        char *raw = mmap(NULL, len + HUGE_PAGE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+            return NULL;
+        p = (char *)(((uintptr_t)raw + HUGE_PAGE - 1) & ~(uintptr_t)(HUGE_PAGE - 1));
+        if (p > raw)
+            munmap(raw, p - raw);
+        munmap(p + len, raw + len + HUGE_PAGE - (p + len));
+        if (*kind == PAGES_THP) {
+#ifdef MADV_HUGEPAGE
+            madvise(p, len, MADV_HUGEPAGE);
+#endif
+        } else {
+#ifdef MADV_NOHUGEPAGE
+            madvise(p, len, MADV_NOHUGEPAGE);   // Только -N: страницы по 4 КБ, как у malloc
+#endif
+        }
+    }
+    if (numa_mode != NUMA_DEFAULT)
+        numa_place(p, len);
+    return p;
+}
+
+void *big_alloc(size_t bytes) {
+    int layered = page_mode != PAGES_DEFAULT || numa_mode != NUMA_DEFAULT;
+    if (bytes < BIG_MIN || (!layered && !memory_report))
+        return aligned_alloc(64, (bytes + 63) & ~(size_t)63);
+
+    pthread_mutex_lock(&big_lock);
+    BigBlock b = { NULL, bytes, 0, page_mode };
+    if (layered) {
+        b.len = (bytes + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+        b.p = big_map(b.len, &b.kind);
+    } else {
+        b.p = aligned_alloc(64, (bytes + 63) & ~(size_t)63);
+    }
+    if (b.p) {
+        if (big_block_count == big_block_capacity) {
+            big_block_capacity = big_block_capacity ? big_block_capacity * 2 : 64;
+            big_blocks = realloc(big_blocks, big_block_capacity * sizeof(BigBlock));
+        }
+        big_blocks[big_block_count++] = b;
+        mem_stats.allocations++;
+        mem_stats.live_bytes += bytes;
+        if (mem_stats.live_bytes > mem_stats.peak_bytes)
+            mem_stats.peak_bytes = mem_stats.live_bytes;
+    }
+    pthread_mutex_unlock(&big_lock);
+    return b.p;
+}
+
+// Отображение уже заполнено нулями
+void *big_calloc(size_t count, size_t size) {
+    size_t bytes = count * size;
+    void *p = big_alloc(bytes);
+    if (p && (bytes < BIG_MIN || (page_mode == PAGES_DEFAULT && numa_mode == NUMA_DEFAULT)))
+        memset(p, 0, bytes);
+    return p;
+}
+
+// Байты VMA, в которой лежит p, по /proc/self/smaps: в больших страницах THP
+// и размер страницы ядра; 0 - не нашлась
+static int smaps_lookup(const char *p, size_t *thp_bytes, size_t *page_size) {
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (!f)
+        return 0;
+    char line[512];
+    int inside = 0, found = 0;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long lo, hi, kb;
+        if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2) {
+            if (found)
+                break;
+            inside = (uintptr_t)p >= lo && (uintptr_t)p < hi;
+            found = inside;
+        } else if (inside && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+            *thp_bytes = kb << 10;
+        } else if (inside && sscanf(line, "KernelPageSize: %lu kB", &kb) == 1) {
+            *page_size = kb << 10;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+// Резидентные страницы массива по узлам и размерам страниц
+static void mem_account(const BigBlock *b) {
+    size_t resident = 0;
+#ifdef __linux__
+    enum { BATCH = 1024 };
+    void *pages[BATCH];
+    int status[BATCH];
+    for (size_t off = 0; off < b->bytes; off += (size_t)BATCH * 4096) {
+        int n = 0;
+        for (size_t o = off; o < b->bytes && n < BATCH; o += 4096)
+            pages[n++] = b->p + o;
+        if (syscall(SYS_move_pages, 0, n, pages, NULL, status, 0) != 0)
+            break;
+        mem_stats.nodes_known = 1;
+        for (int i = 0; i < n; ++i) {
+            if (status[i] < 0 || status[i] >= MAX_NODES)
+                continue;
+            size_t page = b->bytes - (off + (size_t)i * 4096);
+            page = page < 4096 ? page : 4096;
+            mem_stats.node_bytes[status[i]] += page;
+            resident += page;
+        }
+    }
+#endif
+    if (!mem_stats.nodes_known)
+        resident = b->bytes;
+
+    size_t thp = 0, page_size = 4096;
+    smaps_lookup(b->p, &thp, &page_size);
+    if (page_size > 4096) {
+        mem_stats.page_bytes[2] += resident;
+    } else {
+        // VMA массива из malloc может быть шире массива
+        if (thp > resident)
+            thp = resident;
+        mem_stats.page_bytes[1] += thp;
+        mem_stats.page_bytes[0] += resident - thp;
+    }
+}
+
+void big_free(void *p) {
+    if (!p)
+        return;
+    pthread_mutex_lock(&big_lock);
+    int i = big_block_count - 1;
+    while (i >= 0 && big_blocks[i].p != p)
+        i--;
+    if (i < 0) {
+        pthread_mutex_unlock(&big_lock);
+        free(p);
+        return;
+    }
+    BigBlock b = big_blocks[i];
+    big_blocks[i] = big_blocks[--big_block_count];
+    if (memory_report)
+        mem_account(&b);
+    mem_stats.live_bytes -= b.bytes;
+    pthread_mutex_unlock(&big_lock);
+    if (b.len)
+        munmap(b.p, b.len);
+    else
+        free(b.p);
+}
+
+// Расширение массива из big_alloc с сохранением первых old_bytes байт; без
+// -H, -N и -M - обычный realloc, который может расширить массив на месте
+void *big_realloc(void *p, size_t old_bytes, size_t bytes) {
+    if (page_mode == PAGES_DEFAULT && numa_mode == NUMA_DEFAULT && !memory_report)
+        return realloc(p, bytes);
+    void *q = big_alloc(bytes);
+    if (p && q)
+        memcpy(q, p, old_bytes < bytes ? old_bytes : bytes);
+    big_free(p);
+    return q;
+}
+
+// Сводка -M в stderr: байты считаются по массивам от BIG_MIN в момент их
+// освобождения, поэтому сумма может превышать наибольший объём
+void mem_print_report(void) {
+    const double mb = 1 << 20;
+    fprintf(stderr, "Память: массивов %d, наибольший объём %.1f МБ\n", mem_stats.allocations,
+            mem_stats.peak_bytes / mb);
+    fprintf(stderr, "  страницы 4 КБ: %.1f МБ, 2 МБ (THP): %.1f МБ, hugetlb: %.1f МБ\n",
+            mem_stats.page_bytes[0] / mb, mem_stats.page_bytes[1] / mb,
+            mem_stats.page_bytes[2] / mb);
+    if (mem_stats.nodes_known) {
+        for (int n = 0; n < MAX_NODES; ++n)
+            if (mem_stats.node_bytes[n] > 0 || (numa_node_mask() >> n & 1))
+                fprintf(stderr, "  узел %d: %.1f МБ\n", n, mem_stats.node_bytes[n] / mb);
+    } else if (mem_stats.allocations > 0) {
+        fprintf(stderr, "  узлы NUMA неизвестны (move_pages недоступен)\n");
+    }
+    if (mem_stats.hugetlb_fallbacks || mem_stats.mbind_failures)
+        fprintf(stderr, "  откатов MAP_HUGETLB -> THP: %d, неудачных mbind: %d\n",
+                mem_stats.hugetlb_fallbacks, mem_stats.mbind_failures);
+}
+
+// Отображение внешних номеров вершин (до 64 бит) в плотные индексы 0..count-1:
+// открытая адресация с линейным пробированием, заполнение не больше половины
+typedef struct {
+    uint64_t *keys;
+    int *slots;         // -1 - пустая ячейка, иначе плотный индекс
+    size_t mask;        // размер таблицы - 1, размер - степень двойки
+    uint64_t *ids;      // плотный индекс -> внешний номер
+    int count;
+    int id_capacity;
+} IdMap;
+
+// Номера вершин для вывода: NULL - индексы совпадают с номерами
+_Thread_local const uint64_t *vertex_ids = NULL;
+
+static inline size_t id_hash(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (size_t)x;
+}
+
+// Очистка отображения с сохранением выделенной памяти
+void idmap_reset(IdMap *m) {
+    if (!m->slots) {
+        m->mask = 2 * INITIAL_IDS - 1;
+        m->keys = malloc((m->mask + 1) * sizeof(uint64_t));
+        m->slots = malloc((m->mask + 1) * sizeof(int));
+        m->id_capacity = INITIAL_IDS;
+        m->ids = malloc(m->id_capacity * sizeof(uint64_t));
+    }
+    memset(m->slots, 0xff, (m->mask + 1) * sizeof(int));
+    m->count = 0;
+}
+
+// Увеличение таблицы вдвое и перенос всех номеров
+static void idmap_grow(IdMap *m) {
+    m->mask = 2 * (m->mask + 1) - 1;
+    free(m->keys);
+    free(m->slots);
+    m->keys = malloc((m->mask + 1) * sizeof(uint64_t));
+    m->slots = malloc((m->mask + 1) * sizeof(int));
+    memset(m->slots, 0xff, (m->mask + 1) * sizeof(int));
+    for (int idx = 0; idx < m->count; ++idx) {
+        size_t i = id_hash(m->ids[idx]) & m->mask;
+        while (m->slots[i] >= 0)
+            i = (i + 1) & m->mask;
+        m->keys[i] = m->ids[idx];
+        m->slots[i] = idx;
+    }
+}
+
+// Плотный индекс вершины; новая вершина получает следующий свободный индекс
+int idmap_get(IdMap *m, uint64_t key) {
+    size_t i = id_hash(key) & m->mask;
+    while (m->slots[i] >= 0) {
+        if (m->keys[i] == key)
+            return m->slots[i];
+        i = (i + 1) & m->mask;
+    }
+
+    if (m->count == m->id_capacity) {
+        m->id_capacity *= 2;
+        m->ids = realloc(m->ids, m->id_capacity * sizeof(uint64_t));
+    }
+    int idx = m->count++;
+    m->ids[idx] = key;
+    m->keys[i] = key;
+    m->slots[i] = idx;
+    if ((size_t)m->count * 2 > m->mask + 1)
+        idmap_grow(m);
+    return idx;
+}
+
+// Плотный индекс уже известной вершины или -1
+int idmap_find(const IdMap *m, uint64_t key) {
+    size_t i = id_hash(key) & m->mask;
+    while (m->slots[i] >= 0) {
+        if (m->keys[i] == key)
+            return m->slots[i];
+        i = (i + 1) & m->mask;
+    }
+    return -1;
+}
+
+void idmap_free(IdMap *m) {
+    free(m->keys);
+    free(m->slots);
+    free(m->ids);
+}
+
+// Разбор неотрицательного номера вершины, 0 - ошибка
+int parse_id(const char **p, uint64_t *id) {
+    const char *s = *p;
+    while (*s == ' ' || *s == '\t')
+        s++;
+    if (*s < '0' || *s > '9')
+        return 0;
+    char *end;
+    errno = 0;
+    *id = strtoull(s, &end, 10);
+    if (errno == ERANGE)
+        return 0;
+    *p = end;
+    return 1;
+}
+
+// вывод вершины под её исходным номером
+void out_vertex(OutWriter *w, int v) {
+    if (vertex_ids)
+        out_u64(w, vertex_ids[v], 0);
+    else
+        out_int(w, v);
+}
+
+// Расчёт расписания (-S): длительности вершин из строк "v = d" нужны только ему
+int schedule = 0;
+int schedule_workers = 0;  // Исполнителей для моделирования, 0 - без моделирования
+
+// Неотрицательный вес после номеров вершин; 0 - не число или вне int
+static int parse_weight(const char **p, int *w) {
+    char *end;
+    errno = 0;
+    long x = strtol(*p, &end, 10);
+    if (end == *p || errno == ERANGE || x < 0 || x > INT_MAX)
+        return 0;
+    *p = end;
+    *w = (int)x;
+    return 1;
+}
+
+// Разбор строки "u v [вес]" или "v = длительность"; 0 - пустая или некорректная
+// строка (сообщение уже выведено) или длительность без -S. Длительность
+// возвращается как ребро с *v = -1. ids != NULL - номера вершин сжимаются
+// в плотные индексы по мере разбора
+static int parse_edge_line(const char *line, int line_number, IdMap *ids, int *u, int *v, int *w) {
+    // Пропускаем пустые строки
+    if (line[0] == '\n' || line[0] == '\0')
+        return 0;
+
+    uint64_t a, b = 0;
+    const char *p = line;
+    int ok = 1;
+    *w = 0;
+    if (ids) {
+        ok = parse_id(&p, &a);
+    } else {
+        char *end;
+        long x = strtol(p, &end, 10);
+        ok = end != p && x >= 0 && x <= INT_MAX;
+        a = (uint64_t)x;
+        p = end;
+    }
+    while (ok && (*p == ' ' || *p == '\t'))
+        p++;
+    int duration = ok && *p == '=';
+    if (duration) {
+        p++;
+        ok = parse_weight(&p, w);
+    } else if (ok && ids) {
+        ok = parse_id(&p, &b);
+    } else if (ok) {
+        char *end;
+        long x = strtol(p, &end, 10);
+        ok = end != p && x >= 0 && x <= INT_MAX;
+        b = (uint64_t)x;
+        p = end;
+    }
+    // Вес ребра необязателен, прочий хвост строки, как и раньше, не проверяется
+    if (ok && !duration) {
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if ((*p >= '0' && *p <= '9') || *p == '-')
+            ok = parse_weight(&p, w);
+    }
+    if (!ok) {
+        fprintf(stderr, "Ошибка в строке %d: '%s'\n", line_number, line);
+        return 0;
+    }
+    if (duration && !schedule)
+        return 0;
+
+    *u = ids ? idmap_get(ids, a) : (int)a;
+    *v = duration ? -1 : ids ? idmap_get(ids, b) : (int)b;
+    return 1;
+}
+
+// Чтение рёбер из потока в переиспользуемый массив, который расширяется по мере заполнения
+int read_edges_stream(FILE *f, Edge **edges_buf, int *capacity, IdMap *ids) {
+    if (*capacity == 0) {
+        *capacity = INITIAL_EDGES;
+        *edges_buf = big_alloc(*capacity * sizeof(Edge));
+    }
+    Edge *edges = *edges_buf;
+    char line[256];
+    int line_number = 0;
+    int edge_count = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        line_number++;
+
+        int u, v, w;
+        if (!parse_edge_line(line, line_number, ids, &u, &v, &w))
+            continue; // пропускаем некорректную строку
+
+        if (edge_count == *capacity) {
+            edges = big_realloc(edges, *capacity * sizeof(Edge), *capacity * 2 * sizeof(Edge));
+            *capacity *= 2;
+            *edges_buf = edges;
+        }
+
+        edges[edge_count].from = u;
+        edges[edge_count].to = v;
+        edges[edge_count].weight = w;
+        edge_count++;
+    }
+    return edge_count;
+}
+
+// Чтение рёбер из файла; возвращает число рёбер или -1, если файл не открылся
+int read_edges(const char *filename, Edge **edges_buf, int *capacity, IdMap *ids) {
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        perror(filename);
+        return -1;
+    }
+    int edge_count = read_edges_stream(f, edges_buf, capacity, ids);
+    fclose(f);
+    return edge_count;
+}
+
+// Конвейерное чтение: блоки файла читаются заранее (io_uring или отдельный
+// поток), а разбор готовых блоков идёт одновременно с чтением следующих
+typedef struct {
+    long long bytes;
+    double total_sec;   // Чтение файла вместе с разбором
+    double parse_sec;   // Разбор готовых блоков
+    double wait_sec;    // Разбор ждёт, пока блок дочитается
+    double read_sec;    // Время в read у потока чтения (только thread)
+    int mode;           // Фактический способ: uring откатывается на thread
+} IngestStats;
+
+int ingest_mode = INGEST_STDIO;
+IngestStats ingest_stats;
+
+static double ingest_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Разбор потока блоков: строка может начинаться в одном блоке и кончаться в другом
+typedef struct {
+    Edge **edges_buf;
+    int *capacity;
+    IdMap *ids;
+    int edge_count;
+    int line_number;
+    int max_vertex;     // Для плотных номеров: число вершин без отдельного прохода
+    char *tail;         // Незаконченная строка с конца предыдущего блока
+    size_t tail_len;
+    size_t tail_capacity;
+} EdgeParser;
+
+// Номер вершины из цифр без знака; 0 - не число или больше 9 цифр
+static inline int parse_small(const char **p, const char *end, int *x) {
+    const char *s = *p;
+    int n = 0, digits = 0;
+    while (s < end && (unsigned)(*s - '0') < 10) {
+        if (++digits > 9)
+            return 0;
+        n = n * 10 + (*s++ - '0');
+    }
+    *p = s;
+    *x = n;
+    return digits > 0;
+}
+
+static void parser_add(EdgeParser *ep, int u, int v, int w) {
+    if (ep->edge_count == *ep->capacity) {
+        *ep->edges_buf = big_realloc(*ep->edges_buf, *ep->capacity * sizeof(Edge),
+                                     *ep->capacity * 2 * sizeof(Edge));
+        *ep->capacity *= 2;
+    }
+    Edge *e = *ep->edges_buf + ep->edge_count++;
+    e->from = u;
+    e->to = v;
+    e->weight = w;
+    if (u > ep->max_vertex) ep->max_vertex = u;
+    if (v > ep->max_vertex) ep->max_vertex = v;
+}
+
+// Одна строка [s, end) без перевода строки; newline - был ли он в файле
+static void parser_line(EdgeParser *ep, const char *s, const char *end, int newline) {
+    ep->line_number++;
+    // Обычная строка "u v [вес]" разбирается на месте, всё остальное - как у fgets
+    if (!ep->ids) {
+        const char *p = s;
+        int u, v, w = 0;
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        if (parse_small(&p, end, &u) && p < end && (*p == ' ' || *p == '\t')) {
+            while (p < end && (*p == ' ' || *p == '\t'))
+                p++;
+            if (parse_small(&p, end, &v)) {
+                while (p < end && (*p == ' ' || *p == '\t'))
+                    p++;
+                if (p < end && (unsigned)(*p - '0') < 10 && parse_small(&p, end, &w))
+                    while (p < end && (*p == ' ' || *p == '\t'))
+                        p++;
+                while (p < end && *p == '\r')
+                    p++;
+                if (p == end) {
+                    parser_add(ep, u, v, w);
+                    return;
+                }
+            }
+        }
+    }
+
+    char buf[256];
+    size_t len = end - s;
+    char *line = len + 2 <= sizeof(buf) ? buf : malloc(len + 2);
+    memcpy(line, s, len);
+    if (newline)
+        line[len++] = '\n';
+    line[len] = '\0';
+    int u, v, w;
+    if (parse_edge_line(line, ep->line_number, ep->ids, &u, &v, &w))
+        parser_add(ep, u, v, w);
+    if (line != buf)
+        free(line);
+}
+
+// Разбор очередного блока; last - блок последний, остаток без перевода строки - строка
+static void parser_feed(EdgeParser *ep, const char *data, size_t len, int last) {
+    const char *p = data, *end = data + len;
+    if (ep->tail_len > 0) {
+        const char *nl = memchr(p, '\n', len);
+        const char *stop = nl ? nl : end;
+        size_t need = ep->tail_len + (stop - p);
+        if (need > ep->tail_capacity) {
+            ep->tail_capacity = need * 2;
+            ep->tail = realloc(ep->tail, ep->tail_capacity);
+        }
+        memcpy(ep->tail + ep->tail_len, p, stop - p);
+        ep->tail_len = need;
+        if (!nl && !last)
+            return;
+        parser_line(ep, ep->tail, ep->tail + ep->tail_len, nl != NULL);
+        ep->tail_len = 0;
+        p = nl ? nl + 1 : end;
+    }
+
+    const char *nl;
+    while (p < end && (nl = memchr(p, '\n', end - p))) {
+        parser_line(ep, p, nl, 1);
+        p = nl + 1;
+    }
+    if (p == end)
+        return;
+    if (last) {
+        parser_line(ep, p, end, 0);
+        return;
+    }
+    if ((size_t)(end - p) > ep->tail_capacity) {
+        ep->tail_capacity = (end - p) * 2;
+        ep->tail = realloc(ep->tail, ep->tail_capacity);
+    }
+    memcpy(ep->tail, p, end - p);
+    ep->tail_len = end - p;
+}
+
+// Поток чтения с двумя буферами: пока один разбирается, во второй идёт read
+typedef struct {
+    int fd;
+    char *buf[2];
+    ssize_t len[2];     // Прочитано байт; 0 - конец файла, -1 - ошибка
+    int full[2];
+    int error;          // errno потока чтения
+    double read_sec;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} ReaderThread;
+
+static void *reader_main(void *arg) {
+    ReaderThread *r = arg;
+    for (int slot = 0;; slot ^= 1) {
+        pthread_mutex_lock(&r->lock);
+        while (r->full[slot])
+            pthread_cond_wait(&r->cond, &r->lock);
+        pthread_mutex_unlock(&r->lock);
+
+        double t0 = ingest_now();
+        ssize_t n = read(r->fd, r->buf[slot], INGEST_BLOCK);
+        r->read_sec += ingest_now() - t0;
+        if (n < 0)
+            r->error = errno;
+
+        pthread_mutex_lock(&r->lock);
+        r->len[slot] = n;
+        r->full[slot] = 1;
+        pthread_cond_signal(&r->cond);
+        pthread_mutex_unlock(&r->lock);
+        if (n <= 0)
+            return NULL;
+    }
+}
+
+static int ingest_thread(int fd, EdgeParser *ep) {
+    ReaderThread r = { .fd = fd };
+    r.buf[0] = malloc(INGEST_BLOCK);
+    r.buf[1] = malloc(INGEST_BLOCK);
+    pthread_mutex_init(&r.lock, NULL);
+    pthread_cond_init(&r.cond, NULL);
+    pthread_t thread;
+    pthread_create(&thread, NULL, reader_main, &r);
+
+    int status = 0;
+    for (int slot = 0;; slot ^= 1) {
+        double t0 = ingest_now();
+        pthread_mutex_lock(&r.lock);
+        while (!r.full[slot])
+            pthread_cond_wait(&r.cond, &r.lock);
+        pthread_mutex_unlock(&r.lock);
+        double t1 = ingest_now();
+        ingest_stats.wait_sec += t1 - t0;
+
+        ssize_t n = r.len[slot];
+        if (n < 0) {
+            errno = r.error;
+            status = -1;
+        }
+        parser_feed(ep, r.buf[slot], n > 0 ? n : 0, n <= 0);
+        ingest_stats.parse_sec += ingest_now() - t1;
+        if (n <= 0)
+            break;
+        ingest_stats.bytes += n;
+
+        pthread_mutex_lock(&r.lock);
+        r.full[slot] = 0;
+        pthread_cond_signal(&r.cond);
+        pthread_mutex_unlock(&r.lock);
+    }
+
+    pthread_join(thread, NULL);
+    ingest_stats.read_sec = r.read_sec;
+    pthread_mutex_destroy(&r.lock);
+    pthread_cond_destroy(&r.cond);
+    free(r.buf[0]);
+    free(r.buf[1]);
+    return status;
+}
+
+#ifdef __linux__
+// Кольца io_uring через системные вызовы, без liburing
+typedef struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_size, cq_size, sqes_size;
+} Uring;
+
+static int uring_init(Uring *u, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    u->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (u->fd < 0)
+        return -1;
+
+    u->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_size > u->sq_size)
+            u->sq_size = u->cq_size;
+        u->cq_size = 0;
+    }
+    u->sq_ring = mmap(NULL, u->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      u->fd, IORING_OFF_SQ_RING);
+    u->cq_ring = u->cq_size
+        ? mmap(NULL, u->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+               u->fd, IORING_OFF_CQ_RING)
+        : u->sq_ring;
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   u->fd, IORING_OFF_SQES);
+    if (u->sq_ring == MAP_FAILED || u->cq_ring == MAP_FAILED || u->sqes == MAP_FAILED) {
+        close(u->fd);
+        return -1;
+    }
+
+    char *sq = u->sq_ring, *cq = u->cq_ring;
+    u->sq_head = (unsigned *)(sq + p.sq_off.head);
+    u->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    u->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *)(sq + p.sq_off.array);
+    u->cq_head = (unsigned *)(cq + p.cq_off.head);
+    u->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    u->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return 0;
+}
+
+static void uring_free(Uring *u) {
+    munmap(u->sqes, u->sqes_size);
+    if (u->cq_size)
+        munmap(u->cq_ring, u->cq_size);
+    munmap(u->sq_ring, u->sq_size);
+    close(u->fd);
+}
+
+// Постановка чтения в очередь и отправка ядру; при ошибке запись снимается
+// с очереди, и в полёте ничего не остаётся
+static int uring_read(Uring *u, int fd, void *buf, unsigned len, off_t offset, uint64_t tag) {
+    unsigned tail = *u->sq_tail;
+    unsigned i = tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[i];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = tag;
+    u->sq_array[i] = i;
+    __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    if (syscall(__NR_io_uring_enter, u->fd, 1, 0, 0, NULL, 0) == 1)
+        return 0;
+    __atomic_store_n(u->sq_tail, tail, __ATOMIC_RELEASE);
+    return -1;
+}
+
+// Ожидание одного завершения
+static int uring_wait(Uring *u, uint64_t *tag, int *res) {
+    unsigned head = *u->cq_head;
+    while (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, u->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0
+            && errno != EINTR)
+            return -1;
+    }
+    struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+    *tag = cqe->user_data;
+    *res = cqe->res;
+    __atomic_store_n(u->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// INGEST_DEPTH блоков в полёте; блоки разбираются по порядку, повторно
+// используется буфер только что разобранного блока. 1 - io_uring недоступен.
+// done[s] = 0 только у блока, чтение которого действительно отправлено ядру;
+// inflight - число отправленных чтений без завершения
+static int ingest_uring(int fd, off_t size, EdgeParser *ep) {
+    Uring u;
+    if (uring_init(&u, INGEST_DEPTH) != 0)
+        return 1;
+
+    char *buf[INGEST_DEPTH];
+    unsigned want[INGEST_DEPTH], got[INGEST_DEPTH];
+    off_t start[INGEST_DEPTH];
+    int done[INGEST_DEPTH];
+    int inflight = 0;
+    long long blocks = (size + INGEST_BLOCK - 1) / INGEST_BLOCK;
+    int status = 0;
+
+    for (int s = 0; s < INGEST_DEPTH; ++s) {
+        buf[s] = malloc(INGEST_BLOCK);
+        done[s] = 1;
+        if (s < blocks && status == 0) {
+            start[s] = (off_t)s * INGEST_BLOCK;
+            want[s] = size - start[s] < INGEST_BLOCK ? size - start[s] : INGEST_BLOCK;
+            got[s] = 0;
+            if (uring_read(&u, fd, buf[s], want[s], start[s], s) != 0) {
+                status = -1;
+            } else {
+                done[s] = 0;
+                inflight++;
+            }
+        }
+    }
+
+    for (long long b = 0; b < blocks && status == 0; ++b) {
+        int s = (int)(b % INGEST_DEPTH);
+        double t0 = ingest_now();
+        while (!done[s]) {
+            uint64_t tag;
+            int res;
+            if (uring_wait(&u, &tag, &res) != 0) {
+                status = -1;
+                break;
+            }
+            inflight--;
+            done[tag] = 1;
+            if (res < 0) {
+                errno = -res;
+                status = -1;
+                break;
+            }
+            // Короткое чтение дочитывается, 0 - файл укоротился
+            got[tag] += res;
+            if (res == 0 || got[tag] == want[tag])
+                continue;
+            if (uring_read(&u, fd, buf[tag] + got[tag], want[tag] - got[tag],
+                           start[tag] + got[tag], tag) != 0) {
+                status = -1;
+                break;
+            }
+            done[tag] = 0;
+            inflight++;
+        }
+        if (status != 0)
+            break;
+        double t1 = ingest_now();
+        ingest_stats.wait_sec += t1 - t0;
+        parser_feed(ep, buf[s], got[s], b == blocks - 1);
+        ingest_stats.parse_sec += ingest_now() - t1;
+        ingest_stats.bytes += got[s];
+
+        long long next = b + INGEST_DEPTH;
+        if (next < blocks) {
+            start[s] = (off_t)next * INGEST_BLOCK;
+            want[s] = size - start[s] < INGEST_BLOCK ? size - start[s] : INGEST_BLOCK;
+            got[s] = 0;
+            if (uring_read(&u, fd, buf[s], want[s], start[s], s) != 0) {
+                status = -1;
+            } else {
+                done[s] = 0;
+                inflight++;
+            }
+        }
+    }
+
+    // При ошибке дожидаемся чтений в полёте, прежде чем освободить буферы.
+    // Если и ожидание не удалось, ядро ещё может писать в буферы: они остаются
+    // неосвобождёнными
+    int error = errno;
+    while (inflight > 0) {
+        uint64_t tag;
+        int res;
+        if (uring_wait(&u, &tag, &res) != 0)
+            break;
+        inflight--;
+    }
+    if (inflight == 0)
+        for (int s = 0; s < INGEST_DEPTH; ++s)
+            free(buf[s]);
+    uring_free(&u);
+    errno = error;
+    return status;
+}
+#endif
+
+// Конвейерное чтение файла рёбер тем же разбором, что у read_edges;
+// *vertex_count - число вершин, посчитанное при разборе (без -c)
+int read_edges_pipelined(const char *filename, Edge **edges_buf, int *capacity, IdMap *ids,
+                         int *vertex_count) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror(filename);
+        return -1;
+    }
+    if (*capacity == 0) {
+        *capacity = INITIAL_EDGES;
+        *edges_buf = big_alloc(*capacity * sizeof(Edge));
+    }
+    EdgeParser ep = { edges_buf, capacity, ids, 0, 0, -1, NULL, 0, 0 };
+    memset(&ingest_stats, 0, sizeof(ingest_stats));
+    double t0 = ingest_now();
+
+    int status = 1;
+#ifdef __linux__
+    // io_uring читает по смещениям, поэтому только обычные файлы
+    struct stat st;
+    if (ingest_mode == INGEST_URING && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        ingest_stats.mode = INGEST_URING;
+        status = ingest_uring(fd, st.st_size, &ep);
+    }
+#endif
+    if (status == 1) {
+        memset(&ingest_stats, 0, sizeof(ingest_stats));
+        ingest_stats.mode = INGEST_THREAD;
+        status = ingest_thread(fd, &ep);
+    }
+    ingest_stats.total_sec = ingest_now() - t0;
+    int error = errno;
+    close(fd);
+    free(ep.tail);
+    if (status != 0) {
+        errno = error;
+        perror(filename);
+        return -1;
+    }
+    *vertex_count = ids ? 0 : ep.max_vertex + 1;
+    return ep.edge_count;
+}
+
 // Подсчёт количества вершин
 int find_vertex_count(Edge *edges, int edge_count) {
     int max = 0;
@@ -16,208 +1194,3067 @@ int find_vertex_count(Edge *edges, int edge_count) {
         if (edges[i].from > max) max = edges[i].from;
         if (edges[i].to > max) max = edges[i].to;
     }
-    return max + 1;
-}
+    return max + 1;
+}
+
+// Граф в одном из представлений
+typedef struct {
+    int vertex_count;
+    int storage;        // STORAGE_STATIC, STORAGE_DYNAMIC, STORAGE_BITSET, STORAGE_SPARSE или STORAGE_VARINT
+    int **adj;          // Строки матрицы смежности
+    uint64_t *bits;     // Битовая матрица: по 64 вершины в слове
+    int words;          // Число слов в строке битовой матрицы
+    int *offset;        // CSR: последователи u - target[offset[u]..offset[u + 1])
+    int *target;
+    int *weight;        // CSR: вес ребра target[i]; NULL - веса рёбер не заданы
+    unsigned char *code;    // Сжатые строки подряд, по длине строки в байтах перед каждой
+    uint64_t *code_base;    // Начало строки каждой VARINT_BLOCK-й вершины
+    size_t code_size;
+} Graph;
+
+// Буферы, переиспользуемые между заданиями пакетного режима
+typedef struct {
+    Edge *edges;
+    int edge_capacity;
+    int **rows;
+    int row_capacity;
+    int *cells;
+    size_t cell_capacity;
+    uint64_t *bits;
+    size_t bit_capacity;
+    int *offsets;
+    int offset_capacity;
+    int *targets;
+    int target_capacity;
+    Edge *sorted;       // Рёбра, упорядоченные по концу, для построения CSR
+    int sorted_capacity;
+    int *weights;
+    int weight_capacity;
+    int weighted;       // Строить CSR с весами рёбер
+    int *durations;     // Длительности вершин для расчёта расписания
+    int duration_capacity;
+    int grouped;        // Рёбра упорядочены по (from, to) без повторов (-u)
+    unsigned char *code;
+    size_t code_capacity;
+    uint64_t *code_bases;
+    int code_base_capacity;
+    int *rev_offsets;   // Обратный граф для запросов по целям
+    int rev_offset_capacity;
+    int *rev_sources;
+    int rev_source_capacity;
+    IdMap ids;
+    int vertex_count;   // Число вершин, посчитанное при чтении; 0 - неизвестно
+} Workspace;
+
+static inline int varint_len(uint32_t x) {
+    int len = 1;
+    while (x >= 0x80) {
+        x >>= 7;
+        len++;
+    }
+    return len;
+}
+
+static inline unsigned char *varint_put(unsigned char *p, uint32_t x) {
+    while (x >= 0x80) {
+        *p++ = (unsigned char)(x | 0x80);
+        x >>= 7;
+    }
+    *p++ = (unsigned char)x;
+    return p;
+}
+
+static inline uint32_t varint_get(const unsigned char *code, uint64_t *pos) {
+    uint64_t p = *pos;
+    uint32_t b = code[p++];
+    uint32_t x = b & 0x7f;
+    for (int shift = 7; b & 0x80; shift += 7) {
+        b = code[p++];
+        x |= (b & 0x7f) << shift;
+    }
+    *pos = p;
+    return x;
+}
+
+// Разность со знаком в varint: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+static inline uint32_t zigzag(int d) {
+    return ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+}
+
+// Сжатые строки из рёбер, упорядоченных по концу (sorted): первый
+// последователь хранится как разность с u, следующие - как разности соседних
+// по возрастанию, всё в varint. Перед строкой - её длина в байтах, смещение
+// хранится только у каждой VARINT_BLOCK-й строки, остальные находятся
+// пропуском предыдущих строк блока
+static int build_varint(Graph *g, Workspace *ws, const Edge *sorted, int edge_count,
+                        int vertex_count) {
+    if (vertex_count <= 0)
+        return 0;
+    int *last = ws->offsets;    // Последний записанный последователь, -1 - ещё нет
+    uint64_t *pos = malloc(vertex_count * sizeof(uint64_t));
+
+    // Длина каждой строки
+    for (int u = 0; u < vertex_count; ++u) {
+        pos[u] = 0;
+        last[u] = -1;
+    }
+    for (int i = 0; i < edge_count; ++i) {
+        int u = sorted[i].from, v = sorted[i].to;
+        pos[u] += varint_len(last[u] < 0 ? zigzag(v - u) : (uint32_t)(v - last[u]));
+        last[u] = v;
+    }
+
+    int blocks = (vertex_count + VARINT_BLOCK - 1) / VARINT_BLOCK;
+    if (blocks > ws->code_base_capacity) {
+        big_free(ws->code_bases);
+        ws->code_bases = big_alloc(blocks * sizeof(uint64_t));
+        ws->code_base_capacity = blocks;
+    }
+    g->code_base = ws->code_bases;
+
+    uint64_t total = 0;
+    for (int u = 0; u < vertex_count; ++u) {
+        if (pos[u] > INT_MAX) {
+            fprintf(stderr, "Слишком много последователей у вершины %d для сжатого представления\n", u);
+            free(pos);
+            return 1;
+        }
+        if (u % VARINT_BLOCK == 0)
+            g->code_base[u / VARINT_BLOCK] = total;
+        last[u] = (int)pos[u];  // Пока хранит длину строки
+        pos[u] = total;
+        total += varint_len(last[u]) + last[u];
+    }
+    if (total > ws->code_capacity) {
+        big_free(ws->code);
+        ws->code = big_alloc(total);
+        ws->code_capacity = total;
+    }
+    g->code = ws->code;
+    g->code_size = total;
+
+    // Запись строк
+    for (int u = 0; u < vertex_count; ++u) {
+        pos[u] = varint_put(g->code + pos[u], last[u]) - g->code;
+        last[u] = -1;
+    }
+    for (int i = 0; i < edge_count; ++i) {
+        int u = sorted[i].from, v = sorted[i].to;
+        uint32_t x = last[u] < 0 ? zigzag(v - u) : (uint32_t)(v - last[u]);
+        pos[u] = varint_put(g->code + pos[u], x) - g->code;
+        last[u] = v;
+    }
+
+    free(pos);
+    return 0;
+}
+
+// Память представления графа в байтах
+size_t graph_bytes(const Graph *g) {
+    size_t n = g->vertex_count;
+    switch (g->storage) {
+    case STORAGE_SPARSE:
+        return (n + 1 + g->offset[n]) * sizeof(int);
+    case STORAGE_VARINT:
+        return g->code_size + (n + VARINT_BLOCK - 1) / VARINT_BLOCK * sizeof(uint64_t);
+    case STORAGE_BITSET:
+        return n * g->words * sizeof(uint64_t);
+    default:
+        return n * n * sizeof(int) + n * sizeof(int *);
+    }
+}
+
+// Выделение памяти для графа в рабочей области и заполнение
+int build_graph(Graph *g, Workspace *ws, int edge_count, int vertex_count, int storage) {
+    static int static_adj[MAX_VERTICES][MAX_VERTICES] = {0};
+
+    g->vertex_count = vertex_count;
+    g->storage = storage;
+    g->adj = NULL;
+    g->bits = NULL;
+    g->words = 0;
+    g->offset = NULL;
+    g->target = NULL;
+    g->weight = NULL;
+    g->code = NULL;
+    g->code_base = NULL;
+    g->code_size = 0;
+
+    if (storage == STORAGE_SPARSE || storage == STORAGE_VARINT) {
+        // Разреженный массив: память пропорциональна числу вершин и рёбер
+        if (vertex_count + 1 > ws->offset_capacity) {
+            big_free(ws->offsets);
+            ws->offsets = big_alloc((vertex_count + 1) * sizeof(int));
+            ws->offset_capacity = vertex_count + 1;
+        }
+        g->offset = ws->offsets;
+
+        // Два прохода сортировки подсчётом: сначала по концу ребра, затем
+        // устойчиво по началу, чтобы строки шли по возрастанию, как в матрице;
+        // offset[x] временно служит позицией вставки. Рёбра после -u уже
+        // упорядочены по (from, to), и первый проход не нужен
+        const Edge *sorted = ws->edges;
+        if (!ws->grouped) {
+            if (edge_count > ws->sorted_capacity) {
+                big_free(ws->sorted);
+                ws->sorted = big_alloc(edge_count * sizeof(Edge));
+                ws->sorted_capacity = edge_count;
+            }
+            memset(g->offset, 0, (vertex_count + 1) * sizeof(int));
+            for (int i = 0; i < edge_count; ++i)
+                g->offset[ws->edges[i].to + 1]++;
+            for (int v = 0; v < vertex_count; ++v)
+                g->offset[v + 1] += g->offset[v];
+            for (int i = 0; i < edge_count; ++i)
+                ws->sorted[g->offset[ws->edges[i].to]++] = ws->edges[i];
+            sorted = ws->sorted;
+        }
+
+        if (storage == STORAGE_VARINT) {
+            g->offset = NULL;
+            return build_varint(g, ws, sorted, edge_count, vertex_count);
+        }
+        if (edge_count > ws->target_capacity) {
+            big_free(ws->targets);
+            ws->targets = big_alloc(edge_count * sizeof(int));
+            ws->target_capacity = edge_count;
+        }
+        g->target = ws->targets;
+
+        memset(g->offset, 0, (vertex_count + 1) * sizeof(int));
+        for (int i = 0; i < edge_count; ++i)
+            g->offset[sorted[i].from + 1]++;
+        for (int u = 0; u < vertex_count; ++u)
+            g->offset[u + 1] += g->offset[u];
+        if (ws->weighted) {
+            if (edge_count > ws->weight_capacity) {
+                big_free(ws->weights);
+                ws->weights = big_alloc(edge_count * sizeof(int));
+                ws->weight_capacity = edge_count;
+            }
+            g->weight = ws->weights;
+            for (int i = 0; i < edge_count; ++i) {
+                int pos = g->offset[sorted[i].from]++;
+                g->target[pos] = sorted[i].to;
+                g->weight[pos] = sorted[i].weight;
+            }
+        } else {
+            for (int i = 0; i < edge_count; ++i)
+                g->target[g->offset[sorted[i].from]++] = sorted[i].to;
+        }
+        // После раскладки offset[u] указывает на конец строки u
+        for (int u = vertex_count; u > 0; --u)
+            g->offset[u] = g->offset[u - 1];
+        g->offset[0] = 0;
+        return 0;
+    }
+
+    if (storage == STORAGE_BITSET) {
+        // Битовая матрица: в 32 раза меньше памяти, чем int на ячейку
+        g->words = (vertex_count + 63) / 64;
+        size_t need = (size_t)vertex_count * g->words;
+        if (need > ws->bit_capacity) {
+            big_free(ws->bits);
+            ws->bits = big_alloc(need * sizeof(uint64_t));
+            ws->bit_capacity = need;
+        }
+        memset(ws->bits, 0, need * sizeof(uint64_t));
+        g->bits = ws->bits;
+        for (int i = 0; i < edge_count; ++i) {
+            int u = ws->edges[i].from;
+            int v = ws->edges[i].to;
+            g->bits[(size_t)u * g->words + (v >> 6)] |= 1ULL << (v & 63);
+        }
+        return 0;
+    }
+
+    if (vertex_count > ws->row_capacity) {
+        big_free(ws->rows);
+        ws->rows = big_alloc(vertex_count * sizeof(int *));
+        ws->row_capacity = vertex_count;
+    }
+    g->adj = ws->rows;
+
+    if (storage == STORAGE_STATIC) {
+        // Статический массив
+        if (vertex_count > MAX_VERTICES) {
+            fprintf(stderr, "Слишком много вершин для статического массива (%d > %d)\n",
+                    vertex_count, MAX_VERTICES);
+            return 1;
+        }
+        for (int i = 0; i < vertex_count; ++i) {
+            g->adj[i] = static_adj[i];
+            memset(g->adj[i], 0, vertex_count * sizeof(int));
+        }
+    } else {
+        // Динамический массив в общем блоке
+        size_t need = (size_t)vertex_count * vertex_count;
+        if (need > ws->cell_capacity) {
+            big_free(ws->cells);
+            ws->cells = big_alloc(need * sizeof(int));
+            ws->cell_capacity = need;
+        }
+        memset(ws->cells, 0, need * sizeof(int));
+        for (int i = 0; i < vertex_count; ++i)
+            g->adj[i] = ws->cells + (size_t)i * vertex_count;
+    }
+
+    // Заполнение графа
+    for (int i = 0; i < edge_count; ++i) {
+        int u = ws->edges[i].from;
+        int v = ws->edges[i].to;
+        g->adj[u][v] = 1;
+    }
+    return 0;
+}
+
+void free_workspace(Workspace *ws) {
+    big_free(ws->edges);
+    big_free(ws->rows);
+    big_free(ws->cells);
+    big_free(ws->bits);
+    big_free(ws->offsets);
+    big_free(ws->targets);
+    big_free(ws->sorted);
+    big_free(ws->weights);
+    big_free(ws->durations);
+    big_free(ws->code);
+    big_free(ws->code_bases);
+    big_free(ws->rev_offsets);
+    big_free(ws->rev_sources);
+    idmap_free(&ws->ids);
+}
+
+// Перенумерация вершин для локальности: номера из файла разбросаны, и
+// in_degree[v], visited[v] при сортировке прыгают по памяти. После
+// перенумерации соседние вершины получают близкие номера
+int relabel_kind = RELABEL_NONE;
+
+// Порядок вершин: order[i] - старый номер вершины, получающей номер i
+int *relabel_order(const Edge *edges, int edge_count, int vertex_count, int kind) {
+    int *order = malloc(vertex_count * sizeof(int));
+    int *degree = calloc(vertex_count, sizeof(int));
+    int max_degree = 0;
+    for (int i = 0; i < edge_count; ++i) {
+        degree[edges[i].from]++;
+        degree[edges[i].to]++;
+    }
+    for (int v = 0; v < vertex_count; ++v)
+        if (degree[v] > max_degree) max_degree = degree[v];
+
+    // Вершины по возрастанию степени (по убыванию для RELABEL_DEGREE),
+    // при равной степени - по номеру; сортировка подсчётом
+    int *by_degree = malloc(vertex_count * sizeof(int));
+    int *start = calloc(max_degree + 2, sizeof(int));
+    for (int v = 0; v < vertex_count; ++v)
+        start[(kind == RELABEL_DEGREE ? max_degree - degree[v] : degree[v]) + 1]++;
+    for (int d = 0; d <= max_degree; ++d)
+        start[d + 1] += start[d];
+    for (int v = 0; v < vertex_count; ++v)
+        by_degree[start[kind == RELABEL_DEGREE ? max_degree - degree[v] : degree[v]]++] = v;
+    free(start);
+
+    if (kind == RELABEL_DEGREE) {
+        free(degree);
+        free(order);
+        return by_degree;
+    }
+
+    // Строки соседей без учёта направления; для RCM соседи по возрастанию
+    // степени: рёбра раскладываются в порядке by_degree
+    int *offset = malloc((vertex_count + 1) * sizeof(int));
+    int *adj = malloc(2 * (size_t)edge_count * sizeof(int));
+    offset[0] = 0;
+    for (int v = 0; v < vertex_count; ++v)
+        offset[v + 1] = offset[v] + degree[v];
+    int *pos = degree;  // Степени больше не нужны: позиция вставки в строку
+    memcpy(pos, offset, vertex_count * sizeof(int));
+    if (kind == RELABEL_RCM) {
+        // Сначала строки в порядке рёбер, затем пересборка по соседям
+        int *row = malloc(2 * (size_t)edge_count * sizeof(int));
+        for (int i = 0; i < edge_count; ++i) {
+            row[pos[edges[i].from]++] = edges[i].to;
+            row[pos[edges[i].to]++] = edges[i].from;
+        }
+        memcpy(pos, offset, vertex_count * sizeof(int));
+        for (int i = 0; i < vertex_count; ++i) {
+            int w = by_degree[i];
+            for (int j = offset[w]; j < offset[w + 1]; ++j)
+                adj[pos[row[j]]++] = w;
+        }
+        free(row);
+    } else {
+        for (int i = 0; i < edge_count; ++i) {
+            adj[pos[edges[i].from]++] = edges[i].to;
+            adj[pos[edges[i].to]++] = edges[i].from;
+        }
+    }
+
+    // Обход в ширину по компонентам; order служит очередью. BFS начинает
+    // компоненты по номеру, RCM - с вершины наименьшей степени
+    char *visited = calloc(vertex_count, 1);
+    int head = 0, tail = 0;
+    for (int i = 0; i < vertex_count; ++i) {
+        int s = kind == RELABEL_RCM ? by_degree[i] : i;
+        if (visited[s])
+            continue;
+        visited[s] = 1;
+        order[tail++] = s;
+        while (head < tail) {
+            int u = order[head++];
+            for (int j = offset[u]; j < offset[u + 1]; ++j) {
+                if (!visited[adj[j]]) {
+                    visited[adj[j]] = 1;
+                    order[tail++] = adj[j];
+                }
+            }
+        }
+    }
+    if (kind == RELABEL_RCM) {
+        for (int i = 0, j = vertex_count - 1; i < j; ++i, --j) {
+            int t = order[i];
+            order[i] = order[j];
+            order[j] = t;
+        }
+    }
+
+    free(visited);
+    free(adj);
+    free(offset);
+    free(degree);
+    free(by_degree);
+    return order;
+}
+
+// Перенумерация рёбер на месте; возвращает исходные номера вершин по новым
+// (для вывода через vertex_ids), *new_of_old - новые номера по старым
+uint64_t *relabel_edges(Edge *edges, int edge_count, int vertex_count, int kind,
+                        const uint64_t *ids, int **new_of_old) {
+    int *order = relabel_order(edges, edge_count, vertex_count, kind);
+    int *map = malloc(vertex_count * sizeof(int));
+    uint64_t *original = malloc(vertex_count * sizeof(uint64_t));
+    for (int i = 0; i < vertex_count; ++i) {
+        map[order[i]] = i;
+        original[i] = ids ? ids[order[i]] : (uint64_t)order[i];
+    }
+    for (int i = 0; i < edge_count; ++i) {
+        edges[i].from = map[edges[i].from];
+        edges[i].to = map[edges[i].to];
+    }
+    free(order);
+    *new_of_old = map;
+    return original;
+}
+
+// Удаление повторных рёбер (-u): поразрядная сортировка LSD по ключу
+// (from, to) несколькими потоками, затем параллельный проход уникальности.
+// Матрица смежности повторы поглощает сама, CSR и сжатые строки - нет
+int dedup_threads = 0;      // Потоков сортировки, 0 - повторы не удаляются
+
+typedef struct {
+    Edge *buf[2];
+    int count;
+    int threads;
+    int bits_to;            // Разрядов номера конца в ключе
+    int passes;
+    int digit_bits;         // Разрядов за проход: ключ делится на проходы поровну
+    int (*hist)[RADIX_SIZE];    // Гистограмма цифры у каждого потока
+    int *kept;              // Оставленные рёбра у каждого потока
+    int result;             // Буфер с итогом
+    pthread_barrier_t barrier;
+} RadixSort;
+
+typedef struct {
+    RadixSort *rs;
+    int id;
+} RadixWorker;
+
+static inline uint64_t edge_key(const RadixSort *rs, const Edge *e) {
+    return (uint64_t)e->from << rs->bits_to | (uint32_t)e->to;
+}
+
+static void *radix_worker(void *arg) {
+    RadixWorker *w = arg;
+    RadixSort *rs = w->rs;
+    int t = w->id;
+    int begin = (int)((long long)rs->count * t / rs->threads);
+    int end = (int)((long long)rs->count * (t + 1) / rs->threads);
+    int *hist = rs->hist[t];
+    int cur = 0;
+
+    // С -N local каждый поток первым касается своей части второго буфера,
+    // и его страницы делятся между узлами потоков поровну
+    if (numa_mode == NUMA_LOCAL)
+        memset(rs->buf[1] + begin, 0, (size_t)(end - begin) * sizeof(Edge));
+
+    int size = 1 << rs->digit_bits, mask = size - 1;
+    for (int pass = 0; pass < rs->passes; ++pass) {
+        int shift = pass * rs->digit_bits;
+        const Edge *src = rs->buf[cur];
+        Edge *dst = rs->buf[cur ^ 1];
+        memset(hist, 0, size * sizeof(int));
+        for (int i = begin; i < end; ++i)
+            hist[(edge_key(rs, &src[i]) >> shift) & mask]++;
+        pthread_barrier_wait(&rs->barrier);
+
+        // Корзины идут по порядку цифр, внутри корзины - части потоков по
+        // порядку, поэтому каждый проход устойчив. Цифра, одинаковая у всех
+        // рёбер, ничего не переставляет, и проход пропускается
+        int pos[RADIX_SIZE];
+        int total = 0, same = 0;
+        for (int d = 0; d < size; ++d) {
+            int sum = 0;
+            for (int u = 0; u < rs->threads; ++u) {
+                if (u == t)
+                    pos[d] = total + sum;
+                sum += rs->hist[u][d];
+            }
+            same |= sum == rs->count;
+            total += sum;
+        }
+        if (!same) {
+            for (int i = begin; i < end; ++i)
+                dst[pos[(edge_key(rs, &src[i]) >> shift) & mask]++] = src[i];
+            cur ^= 1;
+        }
+        pthread_barrier_wait(&rs->barrier);
+    }
+
+    // Из одинаковых рёбер остаётся первое с наибольшей задержкой; серия
+    // повторов может продолжаться в части следующего потока
+    const Edge *src = rs->buf[cur];
+    Edge *dst = rs->buf[cur ^ 1];
+    int kept = 0;
+    for (int i = begin; i < end; ++i)
+        kept += i == 0 || edge_key(rs, &src[i]) != edge_key(rs, &src[i - 1]);
+    rs->kept[t] = kept;
+    pthread_barrier_wait(&rs->barrier);
+
+    int out = 0;
+    for (int u = 0; u < t; ++u)
+        out += rs->kept[u];
+    for (int i = begin; i < end; ++i) {
+        uint64_t key = edge_key(rs, &src[i]);
+        if (i > 0 && key == edge_key(rs, &src[i - 1]))
+            continue;
+        Edge e = src[i];
+        for (int j = i + 1; j < rs->count && edge_key(rs, &src[j]) == key; ++j)
+            if (src[j].weight > e.weight)
+                e.weight = src[j].weight;
+        dst[out++] = e;
+    }
+    if (t == 0)
+        rs->result = cur ^ 1;
+    return NULL;
+}
+
+static int bit_length(unsigned x) {
+    return x ? 32 - __builtin_clz(x) : 0;
+}
+
+// Сортировка ws->edges по (from, to) и удаление повторов; итог остаётся в
+// ws->edges (буферы ws->edges и ws->sorted могут поменяться местами).
+// Возвращает число оставшихся рёбер, *removed - число удалённых
+int dedup_edges(Workspace *ws, int edge_count, int vertex_count, int threads, int *removed) {
+    if (edge_count > ws->sorted_capacity) {
+        big_free(ws->sorted);
+        ws->sorted = big_alloc(edge_count * sizeof(Edge));
+        ws->sorted_capacity = edge_count;
+    }
+    if (threads > edge_count / DEDUP_MIN_CHUNK)
+        threads = edge_count / DEDUP_MIN_CHUNK;
+    if (threads < 1)
+        threads = 1;
+
+    RadixSort rs;
+    rs.buf[0] = ws->edges;
+    rs.buf[1] = ws->sorted;
+    rs.count = edge_count;
+    rs.threads = threads;
+    int bits = bit_length(vertex_count > 0 ? (unsigned)vertex_count - 1 : 0);
+    rs.bits_to = bits;
+    rs.passes = (2 * bits + RADIX_BITS - 1) / RADIX_BITS;
+    rs.digit_bits = rs.passes ? (2 * bits + rs.passes - 1) / rs.passes : 1;
+    rs.hist = malloc(threads * sizeof(*rs.hist));
+    rs.kept = malloc(threads * sizeof(int));
+    pthread_barrier_init(&rs.barrier, NULL, threads);
+
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    RadixWorker *workers = malloc(threads * sizeof(RadixWorker));
+    for (int t = 0; t < threads; ++t) {
+        workers[t].rs = &rs;
+        workers[t].id = t;
+    }
+    // Нулевую часть сортирует вызвавший поток
+    for (int t = 1; t < threads; ++t)
+        pthread_create(&tids[t], NULL, radix_worker, &workers[t]);
+    radix_worker(&workers[0]);
+    for (int t = 1; t < threads; ++t)
+        pthread_join(tids[t], NULL);
+
+    int kept = 0;
+    for (int t = 0; t < threads; ++t)
+        kept += rs.kept[t];
+    if (rs.result == 1) {
+        Edge *edges = ws->edges;
+        int capacity = ws->edge_capacity;
+        ws->edges = ws->sorted;
+        ws->edge_capacity = ws->sorted_capacity;
+        ws->sorted = edges;
+        ws->sorted_capacity = capacity;
+    }
+    ws->grouped = 1;
+
+    pthread_barrier_destroy(&rs.barrier);
+    free(rs.hist);
+    free(rs.kept);
+    free(tids);
+    free(workers);
+    *removed = edge_count - kept;
+    return kept;
+}
+
+// Обход последователей вершины
+typedef struct {
+    int v;          // Следующий столбец матрицы, позиция в target или последний выданный
+    int end;        // Конец строки CSR или число ещё не прочитанных байт сжатой строки
+    int word;       // Текущее слово строки битовой матрицы; у сжатой строки 1 после первого
+    uint64_t rest;  // Ещё не выданные биты текущего слова или позиция в code
+} SuccIter;
+
+static inline void succ_begin(const Graph *g, int u, SuccIter *it) {
+    it->v = 0;
+    it->end = 0;
+    it->word = 0;
+    it->rest = 0;
+    if (g->storage == STORAGE_BITSET) {
+        it->rest = g->bits[(size_t)u * g->words];
+    } else if (g->storage == STORAGE_SPARSE) {
+        it->v = g->offset[u];
+        it->end = g->offset[u + 1];
+    } else if (g->storage == STORAGE_VARINT) {
+        // Пропуск предыдущих строк блока по их длинам
+        uint64_t p = g->code_base[u / VARINT_BLOCK];
+        for (int w = u % VARINT_BLOCK; w > 0; --w) {
+            uint32_t len = varint_get(g->code, &p);
+            p += len;
+        }
+        it->end = (int)varint_get(g->code, &p);
+        it->rest = p;
+        it->v = u;
+    }
+}
+
+// Следующий последователь вершины u или -1; пустые слова битовой матрицы
+// пропускаются целиком, установленные биты находятся через ctz
+static inline int succ_next(const Graph *g, int u, SuccIter *it) {
+    if (g->storage == STORAGE_SPARSE)
+        return it->v < it->end ? g->target[it->v++] : -1;
+
+    if (g->storage == STORAGE_VARINT) {
+        if (it->end == 0)
+            return -1;
+        uint64_t p = it->rest;
+        uint32_t x = varint_get(g->code, &it->rest);
+        it->end -= (int)(it->rest - p);
+        if (it->word) {
+            it->v += (int)x;
+        } else {
+            it->v += (int)(x >> 1) ^ -(int)(x & 1);
+            it->word = 1;
+        }
+        return it->v;
+    }
+
+    if (g->storage == STORAGE_BITSET) {
+        const uint64_t *row = g->bits + (size_t)u * g->words;
+        while (it->rest == 0) {
+            if (++it->word >= g->words)
+                return -1;
+            it->rest = row[it->word];
+        }
+        int bit = __builtin_ctzll(it->rest);
+        it->rest &= it->rest - 1;
+        return it->word * 64 + bit;
+    }
+
+    const int *row = g->adj[u];
+    while (it->v < g->vertex_count) {
+        int v = it->v++;
+        if (row[v])
+            return v;
+    }
+    return -1;
+}
+
+// Временная память движков сортировки. Без арены - обычные malloc/free;
+// у потоков сервера своя арена, которая сбрасывается между запросами,
+// поэтому массивы одинакового размера выделяются заново без обращения к malloc
+typedef struct {
+    char *base;
+    size_t used;
+    size_t capacity;
+    size_t overflow;    // Байт, не поместившихся в арену с последнего сброса
+    void **extra;       // Отдельные блоки для них, освобождаются при сбросе
+    int extra_count;
+    int extra_capacity;
+} Arena;
+
+_Thread_local Arena *scratch = NULL;
+
+void *scratch_alloc(size_t bytes) {
+    if (!scratch)
+        return big_alloc(bytes);
+    Arena *a = scratch;
+    bytes = (bytes + 63) & ~(size_t)63;     // Массивы начинаются с новой строки кэша
+    if (a->used + bytes <= a->capacity) {
+        void *p = a->base + a->used;
+        a->used += bytes;
+        return p;
+    }
+    if (a->extra_count == a->extra_capacity) {
+        a->extra_capacity = a->extra_capacity ? a->extra_capacity * 2 : 8;
+        a->extra = realloc(a->extra, a->extra_capacity * sizeof(void *));
+    }
+    a->overflow += bytes;
+    return a->extra[a->extra_count++] = malloc(bytes);
+}
+
+void *scratch_calloc(size_t count, size_t size) {
+    if (!scratch)
+        return big_calloc(count, size);
+    void *p = scratch_alloc(count * size);
+    memset(p, 0, count * size);
+    return p;
+}
+
+// В арене память возвращается только при сбросе
+void scratch_free(void *p) {
+    if (!scratch)
+        big_free(p);
+}
+
+// Сброс между запросами: если память не поместилась, арена растёт до нужного объёма
+void arena_reset(Arena *a) {
+    for (int i = 0; i < a->extra_count; ++i)
+        free(a->extra[i]);
+    a->extra_count = 0;
+    if (a->overflow > 0) {
+        free(a->base);
+        a->capacity = (a->used + a->overflow + 4095) & ~(size_t)4095;
+        a->base = aligned_alloc(64, a->capacity);
+        a->overflow = 0;
+    }
+    a->used = 0;
+}
+
+void arena_free(Arena *a) {
+    arena_reset(a);
+    free(a->base);
+    free(a->extra);
+}
+
+// Подсчёт полустепеней захода
+void compute_in_degree(const Graph *g, int *in_degree) {
+    int n = g->vertex_count;
+
+    if (g->storage == STORAGE_SPARSE) {
+        for (int i = 0; i < g->offset[n]; ++i)
+            in_degree[g->target[i]]++;
+        return;
+    }
+
+    if (g->storage == STORAGE_VARINT) {
+        // Строки лежат подряд, поэтому пропуск по блокам не нужен
+        uint64_t p = 0;
+        for (int u = 0; u < n; ++u) {
+            uint64_t end = varint_get(g->code, &p);
+            end += p;
+            for (int v = u, first = 1; p < end; first = 0) {
+                uint32_t x = varint_get(g->code, &p);
+                v += first ? (int)(x >> 1) ^ -(int)(x & 1) : (int)x;
+                in_degree[v]++;
+            }
+        }
+        return;
+    }
+
+    if (g->storage != STORAGE_BITSET) {
+        for (int u = 0; u < n; ++u)
+            for (int v = 0; v < n; ++v)
+                if (g->adj[u][v])
+                    in_degree[v]++;
+        return;
+    }
+
+    // Для битовой матрицы столбцы считаются сразу по 64: k-й разряд всех 64
+    // счётчиков слова хранится в одном слове planes[w * levels + k], строка
+    // прибавляется поразрядным сложением с переносом
+    int levels = 1;
+    while ((1LL << levels) <= n)
+        levels++;
+    uint64_t *planes = calloc((size_t)g->words * levels, sizeof(uint64_t));
+
+    for (int u = 0; u < n; ++u) {
+        const uint64_t *row = g->bits + (size_t)u * g->words;
+        for (int w = 0; w < g->words; ++w) {
+            uint64_t carry = row[w];
+            uint64_t *p = planes + (size_t)w * levels;
+            for (int k = 0; carry; ++k) {
+                uint64_t next = p[k] & carry;
+                p[k] ^= carry;
+                carry = next;
+            }
+        }
+    }
+
+    for (int w = 0; w < g->words; ++w) {
+        const uint64_t *p = planes + (size_t)w * levels;
+        int lanes = n - w * 64 < 64 ? n - w * 64 : 64;
+        for (int b = 0; b < lanes; ++b) {
+            int d = 0;
+            for (int k = 0; k < levels; ++k)
+                d |= (int)((p[k] >> b) & 1) << k;
+            in_degree[w * 64 + b] = d;
+        }
+    }
+    free(planes);
+}
+
+// Порядок Кана с очередью FIFO; возвращает число упорядоченных вершин
+int kahn_order(const Graph *g, int *result) {
+    int vertex_count = g->vertex_count;
+    int *in_degree = scratch_calloc(vertex_count, sizeof(int));
+    int *queue = scratch_alloc(vertex_count * sizeof(int));
+    int front = 0, rear = 0, count = 0;
+
+    compute_in_degree(g, in_degree);
+
+    for (int i = 0; i < vertex_count; ++i)
+        if (in_degree[i] == 0)
+            queue[rear++] = i;
+
+    while (front < rear) {
+        int u = queue[front++];
+        result[count++] = u;
+
+        SuccIter it;
+        succ_begin(g, u, &it);
+        for (int v = succ_next(g, u, &it); v >= 0; v = succ_next(g, u, &it)) {
+            in_degree[v]--;
+            if (in_degree[v] == 0)
+                queue[rear++] = v;
+        }
+    }
+
+    scratch_free(in_degree);
+    scratch_free(queue);
+    return count;
+}
+
+// Топологическая сортировка методом Кана
+void top_sort_kahn(const Graph *g) {
+    int *result = scratch_alloc(g->vertex_count * sizeof(int));
+    int count = kahn_order(g, result);
+
+    if (count != g->vertex_count) {
+        out_cycle(&out);
+    } else {
+        out_begin(&out, "Результат (Кан): ", count);
+        for (int i = 0; i < count; ++i)
+            out_vertex(&out, result[i]);
+        out_end(&out);
+    }
+
+    scratch_free(result);
+}
+
+// Элемент кучи: меньший ключ извлекается раньше
+typedef struct {
+    uint64_t key;
+    int v;
+} HeapItem;
+
+// 4-арная неявная куча: потомки i - 4i+1..4i+4; массив сдвинут на три
+// элемента от выровненного начала, чтобы четвёрка потомков (4 * 16 байт)
+// занимала ровно одну строку кэша
+typedef struct {
+    HeapItem *items;
+    HeapItem *base;
+    int size;
+} Heap4;
+
+void heap_init(Heap4 *h, int capacity) {
+    size_t bytes = (size_t)(capacity + 3) * sizeof(HeapItem);
+    h->base = big_alloc(bytes);
+    h->items = h->base + 3;
+    h->size = 0;
+}
+
+void heap_push(Heap4 *h, uint64_t key, int v) {
+    int i = h->size++;
+    while (i > 0) {
+        int parent = (i - 1) / 4;
+        if (h->items[parent].key <= key)
+            break;
+        h->items[i] = h->items[parent];
+        i = parent;
+    }
+    h->items[i].key = key;
+    h->items[i].v = v;
+}
+
+int heap_pop(Heap4 *h) {
+    int top = h->items[0].v;
+    HeapItem last = h->items[--h->size];
+    int i = 0;
+    for (;;) {
+        int first = 4 * i + 1;
+        if (first >= h->size)
+            break;
+        int last_child = first + 4 < h->size ? first + 4 : h->size;
+        int best = first;
+        for (int c = first + 1; c < last_child; ++c)
+            if (h->items[c].key < h->items[best].key)
+                best = c;
+        if (h->items[best].key >= last.key)
+            break;
+        h->items[i] = h->items[best];
+        i = best;
+    }
+    if (h->size > 0)
+        h->items[i] = last;
+    return top;
+}
+
+void heap_free(Heap4 *h) {
+    big_free(h->base);
+}
+
+// Очередь по корзинам для небольших целых приоритетов: корзина - список FIFO
+// через next[], непустые корзины отмечены в двухуровневой битовой маске,
+// поэтому лучшая корзина находится двумя ctz
+typedef struct {
+    int head[BUCKET_RANGE];
+    int tail[BUCKET_RANGE];
+    uint64_t used[BUCKET_RANGE / 64];
+    uint64_t summary;
+    int *next;
+} BucketQueue;
+
+BucketQueue *bucket_create(int vertex_count) {
+    BucketQueue *q = malloc(sizeof(BucketQueue));
+    memset(q->head, 0xff, sizeof(q->head));
+    memset(q->tail, 0xff, sizeof(q->tail));
+    memset(q->used, 0, sizeof(q->used));
+    q->summary = 0;
+    q->next = malloc(vertex_count * sizeof(int));
+    return q;
+}
+
+// rank - номер корзины, меньший извлекается раньше
+void bucket_push(BucketQueue *q, int rank, int v) {
+    q->next[v] = -1;
+    if (q->tail[rank] < 0)
+        q->head[rank] = v;
+    else
+        q->next[q->tail[rank]] = v;
+    q->tail[rank] = v;
+    q->used[rank / 64] |= 1ULL << (rank % 64);
+    q->summary |= 1ULL << (rank / 64);
+}
+
+int bucket_pop(BucketQueue *q) {
+    int w = __builtin_ctzll(q->summary);
+    int rank = w * 64 + __builtin_ctzll(q->used[w]);
+    int v = q->head[rank];
+    q->head[rank] = q->next[v];
+    if (q->head[rank] < 0) {
+        q->tail[rank] = -1;
+        q->used[w] &= ~(1ULL << (rank % 64));
+        if (!q->used[w])
+            q->summary &= ~(1ULL << w);
+    }
+    return v;
+}
+
+void bucket_free(BucketQueue *q) {
+    free(q->next);
+    free(q);
+}
+
+// 0 - всегда куча (для сравнения в бенчмарке)
+int use_bucket_queue = 1;
+
+// Топологическая сортировка методом Кана с приоритетом: из готовых вершин
+// первой берётся вершина с наибольшим prio[v], при равенстве - ставшая готовой
+// раньше; при prio == NULL - вершина с наименьшим исходным номером
+void top_sort_priority(const Graph *g, const int *prio) {
+    int vertex_count = g->vertex_count;
+    int *in_degree = scratch_calloc(vertex_count, sizeof(int));
+    int *result = scratch_alloc(vertex_count * sizeof(int));
+    int count = 0;
+
+    compute_in_degree(g, in_degree);
+
+    // Небольшой разброс приоритетов позволяет обойтись корзинами вместо кучи
+    int max_prio = 0, min_prio = 0;
+    if (prio && vertex_count > 0) {
+        max_prio = min_prio = prio[0];
+        for (int i = 1; i < vertex_count; ++i) {
+            if (prio[i] > max_prio) max_prio = prio[i];
+            if (prio[i] < min_prio) min_prio = prio[i];
+        }
+    }
+    int buckets = prio && use_bucket_queue && (long long)max_prio - min_prio < BUCKET_RANGE;
+
+    Heap4 heap;
+    BucketQueue *bq = NULL;
+    if (buckets)
+        bq = bucket_create(vertex_count);
+    else
+        heap_init(&heap, vertex_count);
+    uint32_t seq = 0;   // Порядковый номер готовности для равных приоритетов
+    int ready = 0;
+
+    for (int v = 0; v < vertex_count; ++v) {
+        if (in_degree[v] != 0)
+            continue;
+        if (buckets)
+            bucket_push(bq, max_prio - prio[v], v);
+        else if (prio)
+            heap_push(&heap, (uint64_t)(uint32_t)(max_prio - prio[v]) << 32 | seq++, v);
+        else
+            heap_push(&heap, vertex_ids ? vertex_ids[v] : (uint64_t)v, v);
+        ready++;
+    }
+
+    while (ready > 0) {
+        int u = buckets ? bucket_pop(bq) : heap_pop(&heap);
+        ready--;
+        result[count++] = u;
+
+        SuccIter it;
+        succ_begin(g, u, &it);
+        for (int v = succ_next(g, u, &it); v >= 0; v = succ_next(g, u, &it)) {
+            if (--in_degree[v] != 0)
+                continue;
+            if (buckets)
+                bucket_push(bq, max_prio - prio[v], v);
+            else if (prio)
+                heap_push(&heap, (uint64_t)(uint32_t)(max_prio - prio[v]) << 32 | seq++, v);
+            else
+                heap_push(&heap, vertex_ids ? vertex_ids[v] : (uint64_t)v, v);
+            ready++;
+        }
+    }
+
+    if (count != vertex_count) {
+        out_cycle(&out);
+    } else {
+        out_begin(&out, "Результат (Кан, приоритет): ", count);
+        for (int i = 0; i < count; ++i)
+            out_vertex(&out, result[i]);
+        out_end(&out);
+    }
+
+    if (buckets)
+        bucket_free(bq);
+    else
+        heap_free(&heap);
+    scratch_free(in_degree);
+    scratch_free(result);
+}
+
+// Приоритет - число вершин в наибольшем пути от вершины до стока;
+// при цикле вершины вне порядка получают 0
+int *critical_path_priorities(const Graph *g) {
+    int vertex_count = g->vertex_count;
+    int *order = scratch_alloc(vertex_count * sizeof(int));
+    int *prio = scratch_calloc(vertex_count, sizeof(int));
+    int count = kahn_order(g, order);
+
+    for (int i = count - 1; i >= 0; --i) {
+        int u = order[i];
+        int best = 0;
+        SuccIter it;
+        succ_begin(g, u, &it);
+        for (int v = succ_next(g, u, &it); v >= 0; v = succ_next(g, u, &it))
+            if (prio[v] > best)
+                best = prio[v];
+        prio[u] = best + 1;
+    }
+
+    scratch_free(order);
+    return prio;
+}
+
+// Расписание работ по порядку Кана: вершина - работа с длительностью из строки
+// "v = d" (по умолчанию 1), вес ребра - задержка между концом одной работы и
+// началом другой; уровень вершины - число рёбер в самом длинном пути до неё.
+// Всё, что проход Кана меняет у последователя, лежит рядом: одно обращение
+// к памяти на ребро вместо трёх
+typedef struct {
+    long long start;        // Наиболее раннее начало
+    int in_degree;          // Ещё не обработанные предшественники
+    int level;
+} ScheduleNode;
+
+typedef struct {
+    ScheduleNode *node;
+    long long *slack;       // Резерв: сдвиг начала, не удлиняющий критический путь
+    long long length;       // Длина критического пути
+    int levels;
+    int max_width;          // Наибольшее число вершин одного уровня
+    int widest_level;
+} Schedule;
+
+// Вес последнего выданного succ_next ребра; веса бывают только у CSR
+static inline int succ_weight(const Graph *g, const SuccIter *it) {
+    return g->weight ? g->weight[it->v - 1] : 0;
+}
+
+// Порядок Кана, в том же проходе - раннее начало, длина критического пути и
+// ширина уровней; резерв требует обратного прохода по готовому порядку.
+// Очередь FIFO совпадает с порядком, поэтому хранится прямо в result
+int kahn_schedule(const Graph *g, const int *duration, int *result, Schedule *s) {
+    int n = g->vertex_count;
+    int *in_degree = scratch_calloc(n, sizeof(int));
+    int *width = scratch_calloc(n + 1, sizeof(int));
+    ScheduleNode *node = scratch_alloc(n * sizeof(ScheduleNode));
+    s->node = node;
+    s->slack = scratch_calloc(n, sizeof(long long));
+    s->length = 0;
+    s->levels = 0;
+    s->max_width = 0;
+    s->widest_level = 0;
+    int front = 0, rear = 0;
+
+    compute_in_degree(g, in_degree);
+
+    for (int i = 0; i < n; ++i) {
+        node[i].start = 0;
+        node[i].in_degree = in_degree[i];
+        node[i].level = 0;
+        if (in_degree[i] == 0)
+            result[rear++] = i;
+    }
+    scratch_free(in_degree);
+
+    while (front < rear) {
+        int u = result[front++];
+        long long finish = node[u].start + duration[u];
+        int level = node[u].level;
+        if (finish > s->length)
+            s->length = finish;
+        if (++width[level] > s->max_width) {
+            s->max_width = width[level];
+            s->widest_level = level;
+        }
+        if (level >= s->levels)
+            s->levels = level + 1;
+
+        SuccIter it;
+        succ_begin(g, u, &it);
+        for (int v = succ_next(g, u, &it); v >= 0; v = succ_next(g, u, &it)) {
+            ScheduleNode *x = &node[v];
+            long long t = finish + succ_weight(g, &it);
+            if (t > x->start)
+                x->start = t;
+            if (level + 1 > x->level)
+                x->level = level + 1;
+            if (--x->in_degree == 0)
+                result[rear++] = v;
+        }
+    }
+
+    // Обратный проход: slack[u] сначала хранит позднее начало работы u
+    if (rear == n) {
+        for (int i = n - 1; i >= 0; --i) {
+            int u = result[i];
+            long long latest = s->length;
+            SuccIter it;
+            succ_begin(g, u, &it);
+            for (int v = succ_next(g, u, &it); v >= 0; v = succ_next(g, u, &it)) {
+                long long t = s->slack[v] - succ_weight(g, &it);
+                if (t < latest)
+                    latest = t;
+            }
+            s->slack[u] = latest - duration[u];
+        }
+        for (int u = 0; u < n; ++u)
+            s->slack[u] -= node[u].start;
+    }
+
+    scratch_free(width);
+    return rear;
+}
+
+// Списочное расписание на workers исполнителях: освободившийся исполнитель
+// берёт готовую работу с наименьшим поздним началом; возвращает время конца
+long long schedule_makespan(const Graph *g, const int *duration, const Schedule *s, int workers) {
+    int n = g->vertex_count;
+    int *in_degree = scratch_calloc(n, sizeof(int));
+    long long *ready_at = scratch_calloc(n, sizeof(long long));
+    // Работы ждут задержки рёбер, затем готовы, затем выполняются
+    Heap4 waiting, ready, running;
+    heap_init(&waiting, n);
+    heap_init(&ready, n);
+    heap_init(&running, n);
+
+    compute_in_degree(g, in_degree);
+    for (int v = 0; v < n; ++v)
+        if (in_degree[v] == 0)
+            heap_push(&waiting, 0, v);
+
+    long long now = 0;
+    int idle = workers;
+    while (waiting.size + ready.size + running.size > 0) {
+        while (waiting.size > 0 && (long long)waiting.items[0].key <= now) {
+            int v = heap_pop(&waiting);
+            heap_push(&ready, (uint64_t)(s->node[v].start + s->slack[v]), v);
+        }
+        for (; idle > 0 && ready.size > 0; --idle) {
+            int v = heap_pop(&ready);
+            heap_push(&running, (uint64_t)(now + duration[v]), v);
+        }
+
+        // Следующее событие: конец работы или истечение задержки
+        long long next = LLONG_MAX;
+        if (running.size > 0)
+            next = (long long)running.items[0].key;
+        if (waiting.size > 0 && (long long)waiting.items[0].key < next)
+            next = (long long)waiting.items[0].key;
+        now = next;
+
+        while (running.size > 0 && (long long)running.items[0].key == now) {
+            int u = heap_pop(&running);
+            idle++;
+            SuccIter it;
+            succ_begin(g, u, &it);
+            for (int v = succ_next(g, u, &it); v >= 0; v = succ_next(g, u, &it)) {
+                long long t = now + succ_weight(g, &it);
+                if (t > ready_at[v])
+                    ready_at[v] = t;
+                if (--in_degree[v] == 0)
+                    heap_push(&waiting, (uint64_t)ready_at[v], v);
+            }
+        }
+    }
+
+    heap_free(&waiting);
+    heap_free(&ready);
+    heap_free(&running);
+    scratch_free(in_degree);
+    scratch_free(ready_at);
+    return now;
+}
+
+// Метод Кана с расчётом расписания (-S): порядок, сводка и по строке
+// "вершина начало резерв" на каждую вершину в порядке сортировки
+void top_sort_schedule(const Graph *g, const int *duration) {
+    int n = g->vertex_count;
+    int *result = scratch_alloc(n * sizeof(int));
+    Schedule s;
+    int count = kahn_schedule(g, duration, result, &s);
+
+    if (count != n) {
+        out_cycle(&out);
+    } else {
+        out_begin(&out, "Результат (Кан): ", count);
+        for (int i = 0; i < count; ++i)
+            out_vertex(&out, result[i]);
+        out_end(&out);
+
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "Критический путь: %lld\nУровней: %d, наибольшая ширина: %d (уровень %d)\n",
+                 s.length, s.levels, s.max_width, s.widest_level);
+        out_str(&out, line);
+        if (schedule_workers > 0) {
+            snprintf(line, sizeof(line), "Время на %d исполнителях: %lld\n", schedule_workers,
+                     schedule_makespan(g, duration, &s, schedule_workers));
+            out_str(&out, line);
+        }
+        out_str(&out, "Расписание (вершина начало резерв):\n");
+        for (int i = 0; i < count; ++i) {
+            int u = result[i];
+            out_vertex(&out, u);
+            out_int(&out, s.node[u].start);
+            out_int(&out, s.slack[u]);
+            out_str(&out, "\n");
+        }
+        out_flush(&out);
+    }
+
+    scratch_free(s.node);
+    scratch_free(s.slack);
+    scratch_free(result);
+}
+
+// Приоритеты из файла: строки "вершина приоритет", остальные вершины - 0;
+// ids != NULL - номера вершин сжаты; NULL, если файл не открылся
+int *load_priorities(const char *filename, const Graph *g, const IdMap *ids) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        perror("Ошибка при открытии файла приоритетов");
+        return NULL;
+    }
+
+    int *prio = scratch_calloc(g->vertex_count, sizeof(int));
+    char line[256];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        if (line[0] == '\n' || line[0] == '#') continue;
+
+        uint64_t id;
+        const char *p = line;
+        char *end;
+        if (!parse_id(&p, &id)) {
+            fprintf(stderr, "Ошибка в строке %d файла приоритетов: '%s'\n", line_number, line);
+            continue;
+        }
+        errno = 0;
+        long value = strtol(p, &end, 10);
+        if (end == p || errno == ERANGE || value > INT32_MAX || value < INT32_MIN) {
+            fprintf(stderr, "Ошибка в строке %d файла приоритетов: '%s'\n", line_number, line);
+            continue;
+        }
+
+        // Вершины, которых нет в графе, пропускаются
+        int v = ids ? idmap_find(ids, id) : (id < (uint64_t)g->vertex_count ? (int)id : -1);
+        if (v >= 0)
+            prio[v] = (int)value;
+    }
+    fclose(file);
+    return prio;
+}
+
+// Топологическая сортировка методом Тарьяна
+_Thread_local int has_cycle = 0;
+
+// Кадр явного стека обхода в глубину
+typedef struct {
+    int u;
+    SuccIter it;
+} DfsFrame;
+
+// Обход в глубину без рекурсии, чтобы длинные цепочки не переполняли стек
+void dfs_tarjan(const Graph *g, int root, int *visited, int *stack, int *top, DfsFrame *frames) {
+    int depth = 0;
+    visited[root] = 1;
+    frames[0].u = root;
+    succ_begin(g, root, &frames[0].it);
+
+    while (depth >= 0) {
+        DfsFrame *f = &frames[depth];
+        int v = succ_next(g, f->u, &f->it);
+        if (v < 0) {
+            visited[f->u] = 2;
+            stack[(*top)++] = f->u;
+            depth--;
+        } else if (visited[v] == 1) {
+            has_cycle = 1;
+            return;
+        } else if (visited[v] == 0) {
+            visited[v] = 1;
+            depth++;
+            frames[depth].u = v;
+            succ_begin(g, v, &frames[depth].it);
+        }
+    }
+}
+
+void top_sort_tarjan(const Graph *g) {
+    int vertex_count = g->vertex_count;
+    int *visited = scratch_calloc(vertex_count, sizeof(int));
+    int *stack = scratch_alloc(vertex_count * sizeof(int));
+    DfsFrame *frames = scratch_alloc(vertex_count * sizeof(DfsFrame));
+    int top = 0;
+    has_cycle = 0;
+
+    for (int i = 0; i < vertex_count && !has_cycle; ++i)
+        if (!visited[i])
+            dfs_tarjan(g, i, visited, stack, &top, frames);
+
+    if (has_cycle) {
+        out_cycle(&out);
+    } else {
+        out_begin(&out, "Результат (Тарьян): ", vertex_count);
+        for (int i = top - 1; i >= 0; --i)
+            out_vertex(&out, stack[i]);
+        out_end(&out);
+    }
+
+    scratch_free(visited);
+    scratch_free(stack);
+    scratch_free(frames);
+}
+
+// Обратный граф в CSR: предшественники v - source[offset[v]..offset[v + 1])
+typedef struct {
+    int vertex_count;
+    int *offset;
+    int *source;
+} ReverseGraph;
+
+// Построение обратного графа по списку рёбер, не зависит от типа хранения
+void build_reverse(ReverseGraph *r, Workspace *ws, int edge_count, int vertex_count) {
+    if (vertex_count + 1 > ws->rev_offset_capacity) {
+        big_free(ws->rev_offsets);
+        ws->rev_offsets = big_alloc((vertex_count + 1) * sizeof(int));
+        ws->rev_offset_capacity = vertex_count + 1;
+    }
+    if (edge_count > ws->rev_source_capacity) {
+        big_free(ws->rev_sources);
+        ws->rev_sources = big_alloc(edge_count * sizeof(int));
+        ws->rev_source_capacity = edge_count;
+    }
+    r->vertex_count = vertex_count;
+    r->offset = ws->rev_offsets;
+    r->source = ws->rev_sources;
+
+    memset(r->offset, 0, (vertex_count + 1) * sizeof(int));
+    for (int i = 0; i < edge_count; ++i)
+        r->offset[ws->edges[i].to + 1]++;
+    for (int v = 0; v < vertex_count; ++v)
+        r->offset[v + 1] += r->offset[v];
+    for (int i = 0; i < edge_count; ++i)
+        r->source[r->offset[ws->edges[i].to]++] = ws->edges[i].from;
+    for (int v = vertex_count; v > 0; --v)
+        r->offset[v] = r->offset[v - 1];
+    r->offset[0] = 0;
+}
+
+// Состояние запросов по целям; метки поколений избавляют от очистки
+// массивов между запросами, поэтому запрос стоит порядка размера предков
+typedef struct {
+    unsigned *stamp;    // 2 * epoch - вершина в обходе, 2 * epoch + 1 - выведена
+    unsigned epoch;
+    int *stack;         // Вершины явного стека обхода
+    int *pos;           // Позиция в списке предшественников для вершины стека
+} AncestorState;
+
+void ancestor_init(AncestorState *st, int vertex_count) {
+    st->stamp = calloc(vertex_count, sizeof(unsigned));
+    st->epoch = 0;
+    st->stack = malloc(vertex_count * sizeof(int));
+    st->pos = malloc(vertex_count * sizeof(int));
+}
+
+void ancestor_free(AncestorState *st) {
+    free(st->stamp);
+    free(st->stack);
+    free(st->pos);
+}
+
+// Топологический порядок подграфа предков целей: обход обратного графа в
+// глубину, вершина выводится после всех своих предшественников;
+// возвращает число вершин или -1 при цикле среди предков
+int ancestor_order(const ReverseGraph *r, const int *targets, int target_count,
+                   AncestorState *st, int *result) {
+    unsigned open = 2 * ++st->epoch, closed = open + 1;
+    int count = 0;
+
+    for (int t = 0; t < target_count; ++t) {
+        if (st->stamp[targets[t]] >= open)
+            continue;
+        int depth = 0;
+        st->stack[0] = targets[t];
+        st->pos[0] = r->offset[targets[t]];
+        st->stamp[targets[t]] = open;
+
+        while (depth >= 0) {
+            int v = st->stack[depth];
+            if (st->pos[depth] == r->offset[v + 1]) {
+                st->stamp[v] = closed;
+                result[count++] = v;
+                depth--;
+                continue;
+            }
+            int u = r->source[st->pos[depth]++];
+            if (st->stamp[u] == open)
+                return -1;
+            if (st->stamp[u] < open) {
+                st->stamp[u] = open;
+                depth++;
+                st->stack[depth] = u;
+                st->pos[depth] = r->offset[u];
+            }
+        }
+    }
+    return count;
+}
+
+// Списки целей "a,b,c", по одному запросу на список
+char **target_lists = NULL;
+int target_list_count = 0;
+
+// Разбор списка целей в плотные индексы; неизвестные номера пропускаются
+int parse_targets(const char *list, int vertex_count, const IdMap *ids, int *targets) {
+    int count = 0;
+    const char *p = list;
+    while (*p) {
+        uint64_t id;
+        if (!parse_id(&p, &id)) {
+            fprintf(stderr, "Некорректный список целей: '%s'\n", list);
+            return -1;
+        }
+        int v = ids ? idmap_find(ids, id) : (id < (uint64_t)vertex_count ? (int)id : -1);
+        if (v < 0)
+            fprintf(stderr, "Вершины %llu нет в графе\n", (unsigned long long)id);
+        else if (count < vertex_count)
+            targets[count++] = v;
+        while (*p == ',' || *p == ' ')
+            p++;
+    }
+    return count;
+}
+
+// Запросы по целям: порядок сборки только для нужных вершин
+int run_targets(Workspace *ws, int edge_count, int vertex_count, int compact) {
+    ReverseGraph r;
+    AncestorState st;
+    build_reverse(&r, ws, edge_count, vertex_count);
+    ancestor_init(&st, vertex_count);
+    int *targets = malloc(vertex_count * sizeof(int));
+    int *result = malloc(vertex_count * sizeof(int));
+    int failed = 0;
+
+    for (int q = 0; q < target_list_count; ++q) {
+        int target_count = parse_targets(target_lists[q], vertex_count, compact ? &ws->ids : NULL, targets);
+        if (target_count < 0) {
+            failed = 1;
+            continue;
+        }
+        int count = ancestor_order(&r, targets, target_count, &st, result);
+        if (count < 0) {
+            out_cycle(&out);
+            continue;
+        }
+        out_begin(&out, "Результат (цели): ", count);
+        for (int i = 0; i < count; ++i)
+            out_vertex(&out, result[i]);
+        out_end(&out);
+    }
+
+    ancestor_free(&st);
+    free(targets);
+    free(result);
+    return failed;
+}
+
+// Индекс достижимости поверх топологического порядка: вершины нумеруются
+// позициями в порядке, путь u -> v возможен только при pos[u] < pos[v]
+typedef struct {
+    const Graph *g;
+    int kind;           // REACH_CLOSURE или REACH_GRAIL
+    int vertex_count;
+    int *pos;
+    uint64_t *rows;     // Замыкание: строка позиции p - достижимые позиции
+    int words;
+    int labels;         // Метки: число обходов
+    int *low;           // Метка i вершины v - [low[i * V + v], post[i * V + v]]
+    int *post;
+    unsigned *stamp;    // Дообход при проверке меток
+    unsigned epoch;
+    int *stack;
+} ReachIndex;
+
+static void reach_closure(ReachIndex *ri, const int *order) {
+    int n = ri->vertex_count;
+    ri->words = (n + 63) / 64;
+    ri->rows = calloc((size_t)n * ri->words, sizeof(uint64_t));
+
+    // Строки заполняются с конца порядка: строка последователя уже готова.
+    // Если последователь уже отмечен, его строка вошла через другого, и
+    // слияние пропускается; строка p содержит только позиции больше p,
+    // поэтому слияние начинается со слова p / 64
+    for (int i = n - 1; i >= 0; --i) {
+        int u = order[i];
+        uint64_t *row = ri->rows + (size_t)i * ri->words;
+        SuccIter it;
+        succ_begin(ri->g, u, &it);
+        for (int v = succ_next(ri->g, u, &it); v >= 0; v = succ_next(ri->g, u, &it)) {
+            int p = ri->pos[v];
+            if (row[p / 64] >> (p % 64) & 1)
+                continue;
+            row[p / 64] |= 1ULL << (p % 64);
+            const uint64_t *src = ri->rows + (size_t)p * ri->words;
+            for (int w = p / 64; w < ri->words; ++w)
+                row[w] |= src[w];
+        }
+    }
+}
+
+static void reach_grail(ReachIndex *ri) {
+    int n = ri->vertex_count;
+    ri->low = malloc((size_t)ri->labels * n * sizeof(int));
+    ri->post = malloc((size_t)ri->labels * n * sizeof(int));
+    int *roots = malloc(n * sizeof(int));
+    int *visited = malloc(n * sizeof(int));
+    DfsFrame *frames = malloc(n * sizeof(DfsFrame));
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+
+    for (int l = 0; l < ri->labels; ++l) {
+        int *low = ri->low + (size_t)l * n;
+        int *post = ri->post + (size_t)l * n;
+        int rank = 0;
+
+        // Каждый обход начинается с вершин в своём случайном порядке
+        for (int i = 0; i < n; ++i)
+            roots[i] = i;
+        for (int i = n - 1; i > 0; --i) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            int j = (int)((state >> 33) % (uint64_t)(i + 1));
+            int t = roots[i];
+            roots[i] = roots[j];
+            roots[j] = t;
+        }
+        memset(visited, 0, n * sizeof(int));
+
+        for (int r = 0; r < n; ++r) {
+            if (visited[roots[r]])
+                continue;
+            int depth = 0;
+            frames[0].u = roots[r];
+            succ_begin(ri->g, roots[r], &frames[0].it);
+            visited[roots[r]] = 1;
+            low[roots[r]] = n;
+
+            while (depth >= 0) {
+                DfsFrame *f = &frames[depth];
+                int v = succ_next(ri->g, f->u, &f->it);
+                if (v < 0) {
+                    post[f->u] = rank++;
+                    if (post[f->u] < low[f->u])
+                        low[f->u] = post[f->u];
+                    if (depth > 0 && low[f->u] < low[frames[depth - 1].u])
+                        low[frames[depth - 1].u] = low[f->u];
+                    depth--;
+                } else if (visited[v]) {
+                    if (low[v] < low[f->u])
+                        low[f->u] = low[v];
+                } else {
+                    visited[v] = 1;
+                    low[v] = n;
+                    depth++;
+                    frames[depth].u = v;
+                    succ_begin(ri->g, v, &frames[depth].it);
+                }
+            }
+        }
+    }
+
+    ri->stamp = calloc(n, sizeof(unsigned));
+    ri->epoch = 0;
+    ri->stack = malloc(n * sizeof(int));
+    free(roots);
+    free(visited);
+    free(frames);
+}
+
+// Построение индекса; 0 - успех, -1 - граф содержит цикл
+int reach_build(ReachIndex *ri, const Graph *g, int kind, int labels) {
+    int n = g->vertex_count;
+    memset(ri, 0, sizeof(*ri));
+    ri->g = g;
+    ri->vertex_count = n;
+
+    int *order = malloc(n * sizeof(int));
+    if (kahn_order(g, order) != n) {
+        free(order);
+        return -1;
+    }
+    ri->pos = malloc(n * sizeof(int));
+    for (int i = 0; i < n; ++i)
+        ri->pos[order[i]] = i;
+
+    if (kind == REACH_AUTO)
+        kind = (long long)n * ((n + 63) / 64) * 8 <= CLOSURE_LIMIT ? REACH_CLOSURE : REACH_GRAIL;
+    ri->kind = kind;
+    if (kind == REACH_CLOSURE) {
+        reach_closure(ri, order);
+    } else {
+        ri->labels = labels > 0 ? labels : GRAIL_LABELS;
+        reach_grail(ri);
+    }
+    free(order);
+    return 0;
+}
+
+// Метки всех обходов вершины u содержат метки v
+static inline int grail_contains(const ReachIndex *ri, int u, int v) {
+    size_t n = ri->vertex_count;
+    for (int l = 0; l < ri->labels; ++l)
+        if (ri->low[l * n + u] > ri->low[l * n + v] || ri->post[l * n + v] > ri->post[l * n + u])
+            return 0;
+    return 1;
+}
+
+// Есть ли путь u -> v
+int reach_query(ReachIndex *ri, int u, int v) {
+    if (u == v)
+        return 1;
+    int pv = ri->pos[v];
+    if (ri->pos[u] > pv)
+        return 0;
+    if (ri->kind == REACH_CLOSURE)
+        return ri->rows[(size_t)ri->pos[u] * ri->words + pv / 64] >> (pv % 64) & 1;
+
+    if (!grail_contains(ri, u, v))
+        return 0;
+    // Метки не исключили путь: обход в глубину с отсечением по меткам и порядку
+    unsigned mark = ++ri->epoch;
+    int top = 0;
+    ri->stack[top++] = u;
+    ri->stamp[u] = mark;
+    while (top > 0) {
+        int x = ri->stack[--top];
+        SuccIter it;
+        succ_begin(ri->g, x, &it);
+        for (int w = succ_next(ri->g, x, &it); w >= 0; w = succ_next(ri->g, x, &it)) {
+            if (w == v)
+                return 1;
+            if (ri->stamp[w] == mark || ri->pos[w] > pv || !grail_contains(ri, w, v))
+                continue;
+            ri->stamp[w] = mark;
+            ri->stack[top++] = w;
+        }
+    }
+    return 0;
+}
+
+// Пакет запросов: answers[i] - есть ли путь from[i] -> to[i]
+void reach_query_batch(ReachIndex *ri, const int *from, const int *to, int count, int *answers) {
+    for (int i = 0; i < count; ++i)
+        answers[i] = reach_query(ri, from[i], to[i]);
+}
+
+void reach_free(ReachIndex *ri) {
+    free(ri->pos);
+    free(ri->rows);
+    free(ri->low);
+    free(ri->post);
+    free(ri->stamp);
+    free(ri->stack);
+}
+
+// Файл запросов достижимости и вид индекса
+const char *reach_file = NULL;
+int reach_kind = REACH_AUTO;
+int reach_labels = GRAIL_LABELS;
+
+// Запросы достижимости: строки "u v" - есть ли путь из u в v
+int run_reach(const Graph *g, const IdMap *ids) {
+    FILE *file = fopen(reach_file, "r");
+    if (!file) {
+        perror("Ошибка при открытии файла запросов");
+        return 1;
+    }
+
+    int capacity = INITIAL_EDGES, count = 0;
+    int *from = malloc(capacity * sizeof(int));
+    int *to = malloc(capacity * sizeof(int));
+    char line[256];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        if (line[0] == '\n' || line[0] == '#') continue;
+
+        uint64_t a, b;
+        const char *p = line;
+        if (!parse_id(&p, &a) || !parse_id(&p, &b)) {
+            fprintf(stderr, "Ошибка в строке %d файла запросов: '%s'\n", line_number, line);
+            continue;
+        }
+        int u = ids ? idmap_find(ids, a) : (a < (uint64_t)g->vertex_count ? (int)a : -1);
+        int v = ids ? idmap_find(ids, b) : (b < (uint64_t)g->vertex_count ? (int)b : -1);
+        if (u < 0 || v < 0) {
+            fprintf(stderr, "Ошибка в строке %d файла запросов: вершины нет в графе\n", line_number);
+            continue;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            from = realloc(from, capacity * sizeof(int));
+            to = realloc(to, capacity * sizeof(int));
+        }
+        from[count] = u;
+        to[count] = v;
+        count++;
+    }
+    fclose(file);
+
+    ReachIndex ri;
+    if (reach_build(&ri, g, reach_kind, reach_labels) != 0) {
+        out_cycle(&out);
+    } else {
+        int *answers = malloc((count > 0 ? count : 1) * sizeof(int));
+        reach_query_batch(&ri, from, to, count, answers);
+        out_begin(&out, "Достижимость: ", count);
+        for (int i = 0; i < count; ++i)
+            out_int(&out, answers[i]);
+        out_end(&out);
+        free(answers);
+        reach_free(&ri);
+    }
+
+    free(from);
+    free(to);
+    return 0;
+}
+
+// Внешняя сортировка: бюджет памяти под рёбра в байтах, 0 - выключена
+long long external_budget = 0;
+
+// Временный файл в TMPDIR; удаляется сразу, место освобождается при закрытии
+int temp_file(void) {
+    const char *dir = getenv("TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/lab1_XXXXXX", dir && *dir ? dir : "/tmp");
+    int fd = mkstemp(path);
+    if (fd < 0)
+        perror("Ошибка при создании временного файла");
+    else
+        unlink(path);
+    return fd;
+}
+
+int write_all(int fd, const void *data, size_t size) {
+    const char *p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("Ошибка записи временного файла");
+            return -1;
+        }
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+int read_at(int fd, void *data, size_t size, off_t offset) {
+    char *p = data;
+    while (size > 0) {
+        ssize_t n = pread(fd, p, size, offset);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            perror("Ошибка чтения временного файла");
+            return -1;
+        }
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+int cmp_edge(const void *a, const void *b) {
+    const Edge *x = a, *y = b;
+    if (x->from != y->from) return x->from < y->from ? -1 : 1;
+    return (x->to > y->to) - (x->to < y->to);
+}
+
+// Чтение отсортированного прогона блоками
+typedef struct {
+    int fd;
+    off_t pos;          // Позиция следующего блока в файле
+    long long left;     // Ещё не прочитанные рёбра
+    Edge *buf;
+    int len, at;
+    Edge head;          // Текущее наименьшее ребро прогона
+} RunReader;
+
+int run_next(RunReader *r, int block) {
+    if (r->at == r->len) {
+        if (r->left == 0)
+            return 0;
+        r->len = r->left < block ? (int)r->left : block;
+        if (read_at(r->fd, r->buf, r->len * sizeof(Edge), r->pos) != 0)
+            return 0;
+        r->pos += r->len * sizeof(Edge);
+        r->left -= r->len;
+        r->at = 0;
+    }
+    r->head = r->buf[r->at++];
+    return 1;
+}
+
+// Вершина очереди в блоке: номер и место в порядке очереди
+typedef struct {
+    int v;
+    int slot;
+} ChunkItem;
+
+int cmp_chunk(const void *a, const void *b) {
+    const ChunkItem *x = a, *y = b;
+    return (x->v > y->v) - (x->v < y->v);
+}
+
+// Метод Кана для графов больше памяти: рёбра сортируются по началу в прогоны
+// на диске и сливаются в файл концов рёбер; в памяти остаются полустепени
+// захода, смещения строк и очередь (16 байт на вершину), а строки читаются
+// блоками не больше бюджета; порядок совпадает с top_sort_kahn
+int external_kahn(const char *filename, long long budget) {
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        perror(filename);
+        return 1;
+    }
+    if (budget < EXTERNAL_MIN_BUDGET)
+        budget = EXTERNAL_MIN_BUDGET;
+
+    // Этап 1: отсортированные прогоны и полустепени захода
+    int run_cap = (int)(budget / sizeof(Edge) < INT32_MAX ? budget / sizeof(Edge) : INT32_MAX);
+    Edge *run = malloc((size_t)run_cap * sizeof(Edge));
+    int run_len = 0;
+    int *run_fds = NULL;
+    long long *run_sizes = NULL;
+    int run_count = 0;
+    int *in_degree = NULL;
+    int vertex_capacity = 0, vertex_count = 0;
+    long long edge_count = 0;
+    char line[256];
+    int line_number = 0, failed = 0;
+
+    for (;;) {
+        int more = fgets(line, sizeof(line), f) != NULL;
+        if (more) {
+            line_number++;
+            int u, v, w;
+            if (!parse_edge_line(line, line_number, NULL, &u, &v, &w))
+                continue; // пропускаем некорректную строку
+
+            int top = (u > v ? u : v) + 1;
+            if (top > vertex_capacity) {
+                int grown = vertex_capacity ? vertex_capacity : INITIAL_IDS;
+                while (grown < top)
+                    grown = grown > INT32_MAX / 2 ? INT32_MAX : grown * 2;
+                in_degree = realloc(in_degree, (size_t)grown * sizeof(int));
+                memset(in_degree + vertex_capacity, 0, (size_t)(grown - vertex_capacity) * sizeof(int));
+                vertex_capacity = grown;
+            }
+            if (top > vertex_count)
+                vertex_count = top;
+            in_degree[v]++;
+            run[run_len].from = u;
+            run[run_len].to = v;
+            run[run_len].weight = w;
+            run_len++;
+            edge_count++;
+        }
+
+        // Заполненный или последний прогон сортируется и уходит на диск
+        if (run_len == run_cap || (!more && run_len > 0)) {
+            qsort(run, run_len, sizeof(Edge), cmp_edge);
+            int fd = temp_file();
+            if (fd < 0 || write_all(fd, run, (size_t)run_len * sizeof(Edge)) != 0) {
+                if (fd >= 0) close(fd);
+                failed = 1;
+                break;
+            }
+            run_fds = realloc(run_fds, (run_count + 1) * sizeof(int));
+            run_sizes = realloc(run_sizes, (run_count + 1) * sizeof(long long));
+            run_fds[run_count] = fd;
+            run_sizes[run_count] = run_len;
+            run_count++;
+            run_len = 0;
+        }
+        if (!more)
+            break;
+    }
+    fclose(f);
+    free(run);
 
-// Топологическая сортировка методом Кана
-void top_sort_kahn(int **adj, int vertex_count) {
-    int *in_degree = calloc(vertex_count, sizeof(int));
-    int *queue = malloc(vertex_count * sizeof(int));
-    int *result = malloc(vertex_count * sizeof(int));
-    int front = 0, rear = 0, count = 0;
+    if (!failed && edge_count == 0) {
+        fprintf(stderr, "Файл %s не содержит корректных рёбер\n", filename);
+        failed = 1;
+    }
+
+    // Этап 2: слияние прогонов в файл концов рёбер, смещения строк в памяти;
+    // половина бюджета - буферы прогонов, половина - буфер записи
+    long long *offset = NULL;
+    int targets_fd = -1;
+    if (!failed) {
+        offset = calloc((size_t)vertex_count + 1, sizeof(long long));
+        targets_fd = temp_file();
+        failed = targets_fd < 0;
+    }
+    if (!failed) {
+        int block = (int)(budget / 2 / run_count / sizeof(Edge));
+        if (block < 1) block = 1;
+        int out_cap = (int)(budget / 2 / sizeof(int));
+        RunReader *readers = calloc(run_count, sizeof(RunReader));
+        int *heap = malloc(run_count * sizeof(int));
+        int heap_size = 0;
+        int *targets = malloc((size_t)out_cap * sizeof(int));
+        int out_len = 0;
+
+        for (int r = 0; r < run_count; ++r) {
+            readers[r].fd = run_fds[r];
+            readers[r].left = run_sizes[r];
+            readers[r].buf = malloc((size_t)block * sizeof(Edge));
+            if (run_next(&readers[r], block))
+                heap[heap_size++] = r;
+        }
+        // Двоичная куча номеров прогонов по текущему ребру
+        for (int i = heap_size / 2 - 1; i >= 0; --i) {
+            for (int j = i;;) {
+                int c = 2 * j + 1;
+                if (c >= heap_size) break;
+                if (c + 1 < heap_size && cmp_edge(&readers[heap[c + 1]].head, &readers[heap[c]].head) < 0) c++;
+                if (cmp_edge(&readers[heap[c]].head, &readers[heap[j]].head) >= 0) break;
+                int t = heap[c]; heap[c] = heap[j]; heap[j] = t;
+                j = c;
+            }
+        }
+
+        while (heap_size > 0 && !failed) {
+            RunReader *r = &readers[heap[0]];
+            offset[r->head.from + 1]++;
+            targets[out_len++] = r->head.to;
+            if (out_len == out_cap) {
+                failed = write_all(targets_fd, targets, (size_t)out_len * sizeof(int)) != 0;
+                out_len = 0;
+            }
+            if (!run_next(r, block))
+                heap[0] = heap[--heap_size];
+            for (int j = 0;;) {
+                int c = 2 * j + 1;
+                if (c >= heap_size) break;
+                if (c + 1 < heap_size && cmp_edge(&readers[heap[c + 1]].head, &readers[heap[c]].head) < 0) c++;
+                if (cmp_edge(&readers[heap[c]].head, &readers[heap[j]].head) >= 0) break;
+                int t = heap[c]; heap[c] = heap[j]; heap[j] = t;
+                j = c;
+            }
+        }
+        if (!failed && out_len > 0)
+            failed = write_all(targets_fd, targets, (size_t)out_len * sizeof(int)) != 0;
+
+        for (int r = 0; r < run_count; ++r)
+            free(readers[r].buf);
+        free(readers);
+        free(heap);
+        free(targets);
+        for (int u = 0; u < vertex_count; ++u)
+            offset[u + 1] += offset[u];
+    }
+    for (int r = 0; r < run_count; ++r)
+        close(run_fds[r]);
+    free(run_fds);
+    free(run_sizes);
+
+    // Этап 3: Кан; строки вершин из начала очереди читаются одним блоком в
+    // порядке возрастания смещений и обрабатываются в порядке очереди
+    if (!failed) {
+        int *queue = malloc((size_t)vertex_count * sizeof(int));
+        int front = 0, rear = 0;
+        long long cap = budget / 2 / sizeof(int);
+        int chunk_cap = (int)(budget / 4 / (sizeof(ChunkItem) + sizeof(long long)));
+        int *buf = malloc((size_t)cap * sizeof(int));
+        ChunkItem *items = malloc((size_t)chunk_cap * sizeof(ChunkItem));
+        long long *start = malloc((size_t)chunk_cap * sizeof(long long));
 
-    for (int u = 0; u < vertex_count; ++u)
         for (int v = 0; v < vertex_count; ++v)
-            if (adj[u][v])
-                in_degree[v]++;
+            if (in_degree[v] == 0)
+                queue[rear++] = v;
 
-    for (int i = 0; i < vertex_count; ++i)
-        if (in_degree[i] == 0)
-            queue[rear++] = i;
+        while (front < rear && !failed) {
+            int u = queue[front];
+            long long deg = offset[u + 1] - offset[u];
 
-    while (front < rear) {
-        int u = queue[front++];
-        result[count++] = u;
+            // Строка больше буфера читается частями
+            if (deg > cap) {
+                for (long long done = 0; done < deg && !failed; done += cap) {
+                    long long part = deg - done < cap ? deg - done : cap;
+                    failed = read_at(targets_fd, buf, part * sizeof(int), (offset[u] + done) * sizeof(int)) != 0;
+                    for (long long k = 0; k < part && !failed; ++k)
+                        if (--in_degree[buf[k]] == 0)
+                            queue[rear++] = buf[k];
+                }
+                front++;
+                continue;
+            }
+
+            int m = 0;
+            long long total = 0;
+            while (front + m < rear && m < chunk_cap) {
+                int v = queue[front + m];
+                long long d = offset[v + 1] - offset[v];
+                if (total + d > cap)
+                    break;
+                items[m].v = v;
+                items[m].slot = m;
+                total += d;
+                m++;
+            }
+
+            // Смежные в файле строки читаются одним pread
+            qsort(items, m, sizeof(ChunkItem), cmp_chunk);
+            long long pos = 0;
+            for (int i = 0; i < m && !failed;) {
+                int j = i;
+                long long first = offset[items[i].v];
+                while (j < m && (j == i || offset[items[j].v] == offset[items[j - 1].v + 1])) {
+                    start[items[j].slot] = pos + offset[items[j].v] - first;
+                    j++;
+                }
+                long long len = offset[items[j - 1].v + 1] - first;
+                if (len > 0)
+                    failed = read_at(targets_fd, buf + pos, len * sizeof(int), first * sizeof(int)) != 0;
+                pos += len;
+                i = j;
+            }
 
-        for (int v = 0; v < vertex_count; ++v) {
-            if (adj[u][v]) {
-                in_degree[v]--;
-                if (in_degree[v] == 0)
-                    queue[rear++] = v;
+            for (int i = 0; i < m && !failed; ++i) {
+                int v = queue[front + i];
+                const int *row = buf + start[i];
+                long long d = offset[v + 1] - offset[v];
+                for (long long k = 0; k < d; ++k)
+                    if (--in_degree[row[k]] == 0)
+                        queue[rear++] = row[k];
             }
+            front += m;
         }
-    }
 
-    if (count != vertex_count) {
-        printf("Граф содержит цикл\n");
-    } else {
-        printf("Результат (Кан): ");
-        for (int i = 0; i < count; ++i)
-            printf("%d ", result[i]);
-        printf("\n");
+        // Очередь уже содержит порядок, отдельный массив результата не нужен
+        if (!failed) {
+            if (rear != vertex_count) {
+                out_cycle(&out);
+            } else {
+                out_begin(&out, "Результат (Кан): ", rear);
+                for (int i = 0; i < rear; ++i)
+                    out_vertex(&out, queue[i]);
+                out_end(&out);
+            }
+        }
+        free(queue);
+        free(buf);
+        free(items);
+        free(start);
     }
 
+    if (targets_fd >= 0)
+        close(targets_fd);
+    free(offset);
     free(in_degree);
-    free(queue);
-    free(result);
+    return failed;
 }
 
-// Топологическая сортировка методом Тарьяна
-int has_cycle = 0;
+// Источник приоритетов для метода Кана с приоритетом
+int priority_mode = PRIORITY_LEX;
+const char *priority_file = NULL;
 
-void dfs_tarjan(int **adj, int u, int *visited, int *stack, int *top, int vertex_count) {
-    if (has_cycle) return;
+// Кэш результатов: каталог, файл записи - готовый вывод задания, имя -
+// хеш содержимого входного файла и параметры, влияющие на вывод
+const char *cache_dir = NULL;
+long long cache_limit = CACHE_DEFAULT_LIMIT;
 
-    visited[u] = 1;
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
 
-    for (int v = 0; v < vertex_count; ++v) {
-        if (!adj[u][v]) continue;
-        if (visited[v] == 1) {
-            has_cycle = 1;
-            return;
-        } else if (visited[v] == 0) {
-            dfs_tarjan(adj, v, visited, stack, top, vertex_count);
+static inline uint64_t load64(const unsigned char *p) {
+    uint64_t x;
+    memcpy(&x, p, 8);
+    return x;
+}
+
+// 128-битный хеш содержимого: четыре независимые полосы по 8 байт,
+// умножение и циклический сдвиг в каждой, как в xxHash64
+void content_hash(const unsigned char *data, size_t size, uint64_t hash[2]) {
+    const uint64_t p1 = 0x9e3779b185ebca87ULL, p2 = 0xc2b2ae3d27d4eb4fULL;
+    uint64_t lane[4] = { p1 + p2, p2, 0, -p1 };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+        for (int k = 0; k < 4; ++k)
+            lane[k] = rotl64(lane[k] + load64(data + i + 8 * k) * p2, 31) * p1;
+
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, size - i < 8 ? size - i : 8);
+    for (size_t j = i + 8; j < size; j += 8) {
+        uint64_t w = 0;
+        memcpy(&w, data + j, size - j < 8 ? size - j : 8);
+        tail = rotl64(tail ^ w * p2, 27) * p1;
+    }
+
+    uint64_t a = rotl64(lane[0], 1) + rotl64(lane[1], 7) + rotl64(lane[2], 12) + rotl64(lane[3], 18);
+    uint64_t b = lane[0] ^ rotl64(lane[1], 29) ^ rotl64(lane[2], 41) ^ rotl64(lane[3], 53);
+    a ^= tail * p1 + size;
+    b ^= rotl64(tail, 33) * p2 + size;
+    for (int k = 0; k < 2; ++k) {
+        uint64_t *h = k ? &b : &a;
+        *h ^= *h >> 33;
+        *h *= p2;
+        *h ^= *h >> 29;
+        *h *= 0x165667b19e3779f9ULL;
+        *h ^= *h >> 32;
+    }
+    hash[0] = a;
+    hash[1] = b;
+}
+
+// Путь записи кэша для файла; 0 - файл не открылся
+int cache_path(const char *filename, int method, int compact, char *path, size_t size) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+
+    uint64_t hash[2] = { 0, 0 };
+    if (st.st_size > 0) {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return 0;
         }
+        madvise(data, st.st_size, MADV_SEQUENTIAL);
+        content_hash(data, st.st_size, hash);
+        munmap(data, st.st_size);
     }
+    close(fd);
 
-    visited[u] = 2;
-    stack[(*top)++] = u;
+    snprintf(path, size, "%s/%016llx%016llx-%llx-m%dp%dc%dn%do%df%d-v2", cache_dir,
+             (unsigned long long)hash[0], (unsigned long long)hash[1], (long long)st.st_size,
+             method, method == 3 ? priority_mode : 0, compact, relabel_kind, out.format, out.framed);
+    return 1;
 }
 
-void top_sort_tarjan(int **adj, int vertex_count) {
-    int *visited = calloc(vertex_count, sizeof(int));
-    int *stack = malloc(vertex_count * sizeof(int));
-    int top = 0;
-    has_cycle = 0;
+// Первый байт записи кэша - вердикт; за CACHE_ORDER следует вывод задания,
+// у CACHE_CYCLE вывода нет: сообщение о цикле выводится заново, потому что в
+// двоичном режиме без -b оно идёт в stderr и в запись не попадает
+#define CACHE_ORDER 'o'
+#define CACHE_CYCLE 'c'
 
-    for (int i = 0; i < vertex_count; ++i)
-        if (!visited[i])
-            dfs_tarjan(adj, i, visited, stack, &top, vertex_count);
+// Попадание: запись отображается в память и выводится без разбора и сортировки
+int cache_lookup(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
 
-    if (has_cycle) {
-        printf("Граф содержит цикл\n");
+    char verdict;
+    if (pread(fd, &verdict, 1, 0) != 1
+        || (verdict != CACHE_ORDER && verdict != CACHE_CYCLE)) {
+        close(fd);
+        return 0;
+    }
+
+    out_flush(&out);
+    if (verdict == CACHE_CYCLE) {
+        out_cycle(&out);
+    } else if (st.st_size > 1) {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return 0;
+        }
+        write_all(out.fd, (char *)data + 1, st.st_size - 1);
+        munmap(data, st.st_size);
+    }
+    // Время изменения служит отметкой последнего использования для LRU
+    futimens(fd, NULL);
+    close(fd);
+    return 1;
+}
+
+typedef struct {
+    char name[256];
+    off_t size;
+    struct timespec used;
+} CacheEntry;
+
+int cmp_cache_entry(const void *a, const void *b) {
+    const CacheEntry *x = a, *y = b;
+    if (x->used.tv_sec != y->used.tv_sec)
+        return x->used.tv_sec < y->used.tv_sec ? -1 : 1;
+    return (x->used.tv_nsec > y->used.tv_nsec) - (x->used.tv_nsec < y->used.tv_nsec);
+}
+
+// Вытеснение давно не использованных записей, пока кэш больше лимита
+void cache_evict(void) {
+    DIR *dir = opendir(cache_dir);
+    if (!dir)
+        return;
+    CacheEntry *entries = NULL;
+    int count = 0, capacity = 0;
+    long long total = 0;
+    struct dirent *de;
+    char path[4096];
+    while ((de = readdir(dir))) {
+        if (de->d_name[0] == '.' || strlen(de->d_name) >= sizeof(entries->name))
+            continue;
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, de->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            entries = realloc(entries, capacity * sizeof(CacheEntry));
+        }
+        strcpy(entries[count].name, de->d_name);
+        entries[count].size = st.st_size;
+        entries[count].used = st.st_mtim;
+        total += st.st_size;
+        count++;
+    }
+    closedir(dir);
+
+    if (total > cache_limit) {
+        qsort(entries, count, sizeof(CacheEntry), cmp_cache_entry);
+        for (int i = 0; i < count && total > cache_limit; ++i) {
+            snprintf(path, sizeof(path), "%s/%s", cache_dir, entries[i].name);
+            if (unlink(path) == 0)
+                total -= entries[i].size;
+        }
+    }
+    free(entries);
+}
+
+// Начало записи в кэш: вывод задания дублируется во временный файл каталога
+int cache_begin(char *tmp_path, size_t size) {
+    snprintf(tmp_path, size, "%s/.tmp.XXXXXX", cache_dir);
+    int fd = mkstemp(tmp_path);
+    if (fd < 0)
+        return -1;
+    fchmod(fd, 0644);
+    char verdict = CACHE_ORDER;
+    if (write(fd, &verdict, 1) != 1) {
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+    out_flush(&out);
+    out.tee = fd;
+    out.cycle = 0;
+    return fd;
+}
+
+// Завершение записи: успешный вывод атомарно становится записью кэша
+void cache_end(int fd, const char *tmp_path, const char *path, int ok) {
+    out_flush(&out);
+    out.tee = -1;
+    // При цикле копия вывода не нужна: остаётся только вердикт
+    if (ok && out.cycle) {
+        char verdict = CACHE_CYCLE;
+        ok = pwrite(fd, &verdict, 1, 0) == 1 && ftruncate(fd, 1) == 0;
+    }
+    close(fd);
+    if (ok && rename(tmp_path, path) == 0) {
+        cache_evict();
     } else {
-        printf("Результат (Тарьян): ");
-        for (int i = top - 1; i >= 0; --i)
-            printf("%d ", stack[i]);
-        printf("\n");
+        unlink(tmp_path);
     }
+}
 
-    free(visited);
-    free(stack);
+// Запуск нужного метода; new_of_old != NULL - граф перенумерован
+int run_method(const Graph *g, int method, const IdMap *ids, const int *new_of_old,
+               const int *durations) {
+    if (durations) {
+        top_sort_schedule(g, durations);
+        return 0;
+    }
+    if (method == 1) {
+        top_sort_kahn(g);
+        return 0;
+    }
+    if (method == 2) {
+        top_sort_tarjan(g);
+        return 0;
+    }
+
+    int *prio = NULL;
+    if (priority_mode == PRIORITY_CRITICAL)
+        prio = critical_path_priorities(g);
+    else if (priority_mode == PRIORITY_FILE && !(prio = load_priorities(priority_file, g, ids)))
+        return 1;
+    if (prio && new_of_old) {
+        // Приоритеты из файла заданы в старых номерах
+        int *moved = scratch_alloc(g->vertex_count * sizeof(int));
+        for (int v = 0; v < g->vertex_count; ++v)
+            moved[new_of_old[v]] = prio[v];
+        scratch_free(prio);
+        prio = moved;
+    }
+    top_sort_priority(g, prio);
+    scratch_free(prio);
+    return 0;
 }
 
-int main() {
-    char filename[100];
+// Строки "v = d" переносятся из рёбер в ws->durations, у остальных вершин
+// длительность 1; возвращает число оставшихся рёбер
+int split_durations(Workspace *ws, int edge_count, int vertex_count) {
+    if (vertex_count > ws->duration_capacity) {
+        big_free(ws->durations);
+        ws->durations = big_alloc(vertex_count * sizeof(int));
+        ws->duration_capacity = vertex_count;
+    }
+    for (int v = 0; v < vertex_count; ++v)
+        ws->durations[v] = 1;
+    int kept = 0;
+    for (int i = 0; i < edge_count; ++i) {
+        Edge e = ws->edges[i];
+        if (e.to < 0) {
+            ws->durations[e.from] = e.weight;
+            continue;
+        }
+        ws->weighted |= e.weight != 0;
+        ws->edges[kept++] = e;
+    }
+    return kept;
+}
 
-    printf("Введите имя файла: ");
-    scanf("%s", filename);
+// Удаление повторных рёбер с сообщением об их числе
+int report_dedup(Workspace *ws, int edge_count, int vertex_count) {
+    int removed;
+    int kept = dedup_edges(ws, edge_count, vertex_count, dedup_threads, &removed);
+    fprintf(stderr, "Удалено повторных рёбер: %d из %d\n", removed, edge_count);
+    return kept;
+}
 
-    int method = 0, storage = 0;
+// Построение графа из прочитанных рёбер и сортировка (или запросы)
+int sort_edges(int edge_count, int method, int storage, int compact, Workspace *ws) {
+    int vertex_count = compact ? ws->ids.count
+                       : ws->vertex_count ? ws->vertex_count
+                       : find_vertex_count(ws->edges, edge_count);
+    ws->vertex_count = 0;
+    vertex_ids = compact ? ws->ids.ids : NULL;
 
-    // Ввод метода сортировки
-    while (1) {
-        printf("Выберите метод сортировки:\n1 - Кан\n2 - Тарьян\n> ");
-        if (scanf("%d", &method) != 1 || (method != 1 && method != 2)) {
-            printf("Некорректный ввод. Пожалуйста, введите 1 или 2.\n");
-            while (getchar() != '\n'); // очистка ввода
-        } else {
-            break;
+    // Веса рёбер хранит только CSR
+    ws->weighted = 0;
+    ws->grouped = 0;
+    if (schedule) {
+        edge_count = split_durations(ws, edge_count, vertex_count);
+        if (ws->weighted && storage != STORAGE_SPARSE) {
+            fprintf(stderr, "Веса рёбер поддерживаются только с -s sparse\n");
+            return 1;
         }
     }
 
-    // Ввод типа хранения
-    while (1) {
-        printf("Выберите тип массива:\n1 - Статический\n2 - Динамический\n> ");
-        if (scanf("%d", &storage) != 1 || (storage != 1 && storage != 2)) {
-            printf("Некорректный ввод. Пожалуйста, введите 1 или 2.\n");
-            while (getchar() != '\n'); // очистка ввода
-        } else {
-            break;
+    // Запросы по целям не строят граф целиком
+    if (target_list_count > 0) {
+        if (dedup_threads > 0)
+            edge_count = report_dedup(ws, edge_count, vertex_count);
+        return run_targets(ws, edge_count, vertex_count, compact);
+    }
+
+    // Сортировка идёт в новых номерах, вывод - в исходных через vertex_ids
+    uint64_t *original = NULL;
+    int *new_of_old = NULL;
+    if (relabel_kind != RELABEL_NONE) {
+        original = relabel_edges(ws->edges, edge_count, vertex_count, relabel_kind,
+                                 vertex_ids, &new_of_old);
+        vertex_ids = original;
+        if (schedule) {
+            int *moved = malloc(vertex_count * sizeof(int));
+            for (int v = 0; v < vertex_count; ++v)
+                moved[new_of_old[v]] = ws->durations[v];
+            memcpy(ws->durations, moved, vertex_count * sizeof(int));
+            free(moved);
         }
     }
 
+    // Повторы удаляются уже в новых номерах, чтобы рёбра остались упорядочены
+    if (dedup_threads > 0)
+        edge_count = report_dedup(ws, edge_count, vertex_count);
 
-    FILE *f = fopen(filename, "r");
+    Graph g;
+    IdMap *ids = compact ? &ws->ids : NULL;
+    int status = build_graph(&g, ws, edge_count, vertex_count, storage);
+    if (status == 0 && reach_file)
+        status = run_reach(&g, ids);
+    else if (status == 0)
+        status = run_method(&g, method, ids, new_of_old, schedule ? ws->durations : NULL);
+
+    if (original) {
+        vertex_ids = NULL;
+        free(original);
+        free(new_of_old);
+    }
+    return status;
+}
+
+// Одно задание: чтение файла, построение графа и сортировка
+int sort_job(const char *filename, int method, int storage, int compact, Workspace *ws) {
+    if (external_budget > 0)
+        return external_kahn(filename, external_budget);
+
+    if (compact)
+        idmap_reset(&ws->ids);
+    IdMap *ids = compact ? &ws->ids : NULL;
+    int edge_count = ingest_mode == INGEST_STDIO
+        ? read_edges(filename, &ws->edges, &ws->edge_capacity, ids)
+        : read_edges_pipelined(filename, &ws->edges, &ws->edge_capacity, ids, &ws->vertex_count);
+    if (edge_count < 0)
+        return 1;
+
+    if (edge_count == 0) {
+        fprintf(stderr, "Файл %s не содержит корректных рёбер\n", filename);
+        return 1;
+    }
+    return sort_edges(edge_count, method, storage, compact, ws);
+}
+
+// Задание с кэшем: вывод зависит только от содержимого файла и параметров;
+// приоритеты из файла, запросы, расписание и внешний режим не кэшируются
+int run_job(const char *filename, int method, int storage, int compact, Workspace *ws) {
+    int cacheable = cache_dir && external_budget == 0 && !target_list_count && !reach_file
+                    && !schedule && !(method == 3 && priority_mode == PRIORITY_FILE);
+    char path[4096], tmp_path[4096];
+    if (!cacheable || !cache_path(filename, method, compact, path, sizeof(path)))
+        return sort_job(filename, method, storage, compact, ws);
+    if (cache_lookup(path))
+        return 0;
+
+    int fd = cache_begin(tmp_path, sizeof(tmp_path));
+    int status = sort_job(filename, method, storage, compact, ws);
+    if (fd >= 0)
+        cache_end(fd, tmp_path, path, status == 0);
+    return status;
+}
+
+// Пакетный режим: список файлов графов, по одному на строку
+int run_batch(const char *manifest, int method, int storage, int compact, Workspace *ws) {
+    FILE *f = fopen(manifest, "r");
     if (!f) {
-        perror("Ошибка при открытии файла");
+        perror(manifest);
         return 1;
     }
 
-    Edge edges[MAX_EDGES];
+    char line[4096];
+    int failed = 0;
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        // Пропускаем пустые строки и комментарии
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        out_str(&out, "# ");
+        out_str(&out, line);
+        out_str(&out, "\n");
+        if (run_job(line, method, storage, compact, ws) != 0) {
+            failed++;
+            if (out.format != OUT_TEXT)
+                out_int(&out, -2); // задание не выполнено
+        }
+    }
+    fclose(f);
+    out_flush(&out);
+    return failed ? 1 : 0;
+}
+
+// Разбор названия метода: 1 - Кан, 2 - Тарьян, 3 - Кан с приоритетом, 0 - ошибка
+int parse_method(const char *s) {
+    if (strcmp(s, "1") == 0 || strcmp(s, "kahn") == 0) return 1;
+    if (strcmp(s, "2") == 0 || strcmp(s, "tarjan") == 0) return 2;
+    if (strcmp(s, "3") == 0 || strcmp(s, "priority") == 0) return 3;
+    return 0;
+}
+
+// Сервер: графы приходят через Unix-сокет, сортируют их потоки пула, каждый со
+// своими рабочей областью и ареной, которые переиспользуются между запросами
+
+// Параметры, общие для всех потоков сервера
+typedef struct {
+    int listen_fd;
+    int storage;
+    int compact;
+} DaemonConfig;
+
+// Рёбра в двоичном виде: пары int32 little-endian (from, to) до конца потока
+int read_edges_binary(FILE *f, Edge **edges_buf, int *capacity, IdMap *ids) {
+    if (*capacity == 0) {
+        *capacity = INITIAL_EDGES;
+        *edges_buf = big_alloc(*capacity * sizeof(Edge));
+    }
     int edge_count = 0;
-    char line[256];
-    int line_number = 0;
+    unsigned char pair[8];
+    while (fread(pair, 1, sizeof(pair), f) == sizeof(pair)) {
+        int32_t a = (int32_t)((uint32_t)pair[0] | (uint32_t)pair[1] << 8
+                              | (uint32_t)pair[2] << 16 | (uint32_t)pair[3] << 24);
+        int32_t b = (int32_t)((uint32_t)pair[4] | (uint32_t)pair[5] << 8
+                              | (uint32_t)pair[6] << 16 | (uint32_t)pair[7] << 24);
+        if (a < 0 || b < 0)
+            continue; // пропускаем некорректное ребро
+        if (edge_count == *capacity) {
+            *edges_buf = big_realloc(*edges_buf, *capacity * sizeof(Edge),
+                                     *capacity * 2 * sizeof(Edge));
+            *capacity *= 2;
+        }
+        (*edges_buf)[edge_count].from = ids ? idmap_get(ids, (uint64_t)a) : a;
+        (*edges_buf)[edge_count].to = ids ? idmap_get(ids, (uint64_t)b) : b;
+        (*edges_buf)[edge_count].weight = 0;
+        edge_count++;
+    }
+    return edge_count;
+}
 
-    while (fgets(line, sizeof(line), f)) {
-        line_number++;
+// Один запрос: строка "метод вход выход" (вход - text или binary, выход - text
+// или binary), затем рёбра до закрытия клиентом своей стороны сокета; ответ -
+// тот же вывод, что в файл, в двоичном виде с длиной перед порядком
+void serve_request(int fd, const DaemonConfig *cfg, Workspace *ws) {
+    // Клиент, который не дописывает запрос или не читает ответ, держал бы
+    // поток сервера бесконечно: каждое чтение и запись ждут не дольше таймаута
+    struct timeval timeout = { DAEMON_TIMEOUT, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    FILE *f = fdopen(fd, "r");
+    if (!f) {
+        close(fd);
+        return;
+    }
 
-        // Пропускаем пустые строки
-        if (line[0] == '\n' || line[0] == '\0')
-            continue;
+    char line[128], method_name[16], input[16] = "", output[16] = "";
+    int method = 0;
+    if (fgets(line, sizeof(line), f)
+        && sscanf(line, "%15s %15s %15s", method_name, input, output) == 3)
+        method = parse_method(method_name);
+    int binary_in = strcmp(input, "binary") == 0;
 
-        int u, v;
-        char extra;
+    out.fd = fd;
+    out.format = OUT_TEXT;
+    if (method && strcmp(output, "binary") == 0)
+        out.format = cfg->compact ? OUT_BINARY64 : OUT_BINARY;
+    out.framed = out.format != OUT_TEXT;
+    out.len = 0;
 
-        int count = sscanf(line, "%d %d %c", &u, &v, &extra);
-        if (count < 2 || u < 0 || v < 0) {
-            printf("Ошибка в строке %d: '%s'\n", line_number, line);
-            continue; // пропускаем некорректную строку
+    int status = 1;
+    if (method && (binary_in || strcmp(input, "text") == 0)) {
+        if (cfg->compact)
+            idmap_reset(&ws->ids);
+        IdMap *ids = cfg->compact ? &ws->ids : NULL;
+        int edge_count = binary_in
+            ? read_edges_binary(f, &ws->edges, &ws->edge_capacity, ids)
+            : read_edges_stream(f, &ws->edges, &ws->edge_capacity, ids);
+        if (ferror(f)) {
+            // Рёбра дочитаны не до конца: неполный граф не сортируем
+            fprintf(stderr, "Запрос прерван: клиент молчит дольше %d с\n", DAEMON_TIMEOUT);
+            fclose(f);
+            return;
         }
+        if (edge_count > 0)
+            status = sort_edges(edge_count, method, cfg->storage, cfg->compact, ws);
+    }
+    if (status != 0) {
+        out_str(&out, "Ошибка: некорректный запрос или пустой граф\n");
+        if (out.format != OUT_TEXT)
+            out_int(&out, -2);
+    }
+    out_flush(&out);
+    fclose(f);
+}
 
-        if (edge_count >= MAX_EDGES) {
-            printf("Превышено допустимое количество рёбер (%d)\n", MAX_EDGES);
+void *daemon_worker(void *arg) {
+    const DaemonConfig *cfg = arg;
+    Workspace ws = {0};
+    Arena arena = {0};
+    scratch = &arena;
+    for (;;) {
+        int fd = accept(cfg->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror("accept");
             break;
         }
+        serve_request(fd, cfg, &ws);
+        arena_reset(&arena);
+    }
+    scratch = NULL;
+    arena_free(&arena);
+    free_workspace(&ws);
+    free(out.buf);
+    return NULL;
+}
 
-        edges[edge_count].from = u;
-        edges[edge_count].to = v;
-        edge_count++;
+// Запуск сервера на сокете path с workers потоками; возвращается только при ошибке
+int run_daemon(const char *path, int workers, int storage, int compact) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Слишком длинный путь сокета: %s\n", path);
+        return 1;
     }
-    fclose(f);
+    strcpy(addr.sun_path, path);
 
-    if (edge_count == 0) {
-        printf("Файл не содержит корректных рёбер. Завершение программы.\n");
+    DaemonConfig cfg = { -1, storage, compact };
+    cfg.listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (cfg.listen_fd < 0 || bind(cfg.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0
+        || listen(cfg.listen_fd, SOMAXCONN) != 0) {
+        perror(path);
         return 1;
     }
+    // Клиент может закрыть соединение, не дочитав ответ
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "Сервер слушает %s, потоков: %d\n", path, workers);
 
-    int vertex_count = find_vertex_count(edges, edge_count);
+    pthread_t *threads = malloc(workers * sizeof(pthread_t));
+    for (int i = 0; i < workers; ++i)
+        pthread_create(&threads[i], NULL, daemon_worker, &cfg);
+    for (int i = 0; i < workers; ++i)
+        pthread_join(threads[i], NULL);
+    free(threads);
+    close(cfg.listen_fd);
+    unlink(path);
+    return 1;
+}
 
-    // Выделение памяти для матрицы смежности
-    int **adj = NULL;
-    static int static_adj[MAX_VERTICES][MAX_VERTICES] = {0};
+// Разбор типа массива: 1 - статический, 2 - динамический, 3 - битовая матрица,
+// 4 - разреженный (CSR), 0 - ошибка
+int parse_storage(const char *s) {
+    if (strcmp(s, "1") == 0 || strcmp(s, "static") == 0) return STORAGE_STATIC;
+    if (strcmp(s, "2") == 0 || strcmp(s, "dynamic") == 0) return STORAGE_DYNAMIC;
+    if (strcmp(s, "3") == 0 || strcmp(s, "bitset") == 0) return STORAGE_BITSET;
+    if (strcmp(s, "4") == 0 || strcmp(s, "sparse") == 0) return STORAGE_SPARSE;
+    if (strcmp(s, "5") == 0 || strcmp(s, "varint") == 0) return STORAGE_VARINT;
+    return 0;
+}
 
-    if (storage == 1) { 
-        // Статический массив
-        adj = (int **)malloc(vertex_count * sizeof(int *));
-        for (int i = 0; i < vertex_count; ++i)
-            adj[i] = static_adj[i];
-    } else {
-        // Динамический массив
-        adj = (int **)malloc(vertex_count * sizeof(int *));
-        for (int i = 0; i < vertex_count; ++i)
-            adj[i] = (int *)calloc(vertex_count, sizeof(int));
+// Конец ввода во время вопросов: ответа уже не будет
+void input_ended(void) {
+    fprintf(stderr, "Ввод закончился, параметры не заданы\n");
+    exit(1);
+}
+
+// Очистка ввода до конца строки после некорректного ответа
+void skip_input_line(void) {
+    int ch;
+    while ((ch = getchar()) != '\n')
+        if (ch == EOF)
+            input_ended();
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "Использование: %s [-f файл | -b список] [-m kahn|tarjan|priority] [-P lex|critical|файл] [-t цели]... [-r запросы [-R вид]] [-x МБ] [-C каталог [-L МБ]] [-s static|dynamic|bitset|sparse|varint] [-c] [-u] [-O bfs|rcm|degree] [-S исполнителей] [-I stdio|thread|uring] [-H thp|huge] [-N interleave|local] [-M] [-D сокет [-j потоков]] [-o text|binary] [-w файл]\n"
+            "  -f файл    файл с рёбрами графа\n"
+            "  -b список  пакетный режим: файл со списком графов, по одному на строку\n"
+            "  -m метод   kahn (1), tarjan (2) или priority (3, Кан с приоритетом)\n"
+            "  -P порядок приоритет для priority: lex - наименьший номер первым,\n"
+            "             critical - наибольший путь до стока первым, иначе файл\n"
+            "             со строками \"вершина приоритет\" (наибольший первым)\n"
+            "  -t цели    порядок только для предков целей \"a,b,c\"; можно\n"
+            "             повторять, каждый список - отдельный запрос\n"
+            "  -r файл    запросы достижимости: строки \"u v\", ответ 1, если есть путь u -> v\n"
+            "  -R вид     индекс: closure (битовое замыкание, V * V / 8 байт),\n"
+            "             grail[:k] (k интервальных меток, 2k int на вершину, по умолчанию 5)\n"
+            "             или auto (замыкание, если не больше 2 ГиБ)\n"
+            "  -x МБ      внешняя сортировка методом Кана для графов больше памяти:\n"
+            "             рёбра сортируются на диске (TMPDIR), бюджет памяти под рёбра в МБ\n"
+            "  -C каталог кэш результатов по хешу содержимого файла и параметрам\n"
+            "  -L МБ      предел размера кэша, старые записи вытесняются (по умолчанию 256)\n"
+            "  -s массив  static (1), dynamic (2), bitset (3), sparse (4, CSR) или\n"
+            "             varint (5, сжатые строки: разности соседних последователей в varint)\n"
+            "  -c         сжатие номеров вершин: произвольные 64-битные номера\n"
+            "             отображаются в плотные индексы, двоичный вывод - int64\n"
+            "  -u         удаление повторных рёбер: параллельная поразрядная сортировка\n"
+            "             по (начало, конец), число удалённых - в stderr\n"
+            "  -O порядок перенумерация вершин перед сортировкой для локальности:\n"
+            "             bfs - обход в ширину, rcm - обратный Катхилл-Макки,\n"
+            "             degree - по убыванию степени; вывод - в исходных номерах\n"
+            "  -S число   расписание методом Кана: строки файла \"u v [задержка]\" и\n"
+            "             \"v = длительность\" (по умолчанию 1); выводятся критический\n"
+            "             путь, ширина уровней, раннее начало и резерв вершин; число > 0 -\n"
+            "             время выполнения на стольких исполнителях, 0 - без него\n"
+            "  -I чтение  stdio - построчно (по умолчанию), thread - поток чтения\n"
+            "             с двумя буферами, uring - несколько чтений в полёте\n"
+            "             через io_uring (без него - как thread); разбор идёт\n"
+            "             одновременно с чтением\n"
+            "  -H страницы большие страницы для больших массивов: thp - прозрачные\n"
+            "             (madvise), huge - hugetlb, без свободных - как thp\n"
+            "  -N узлы    размещение по узлам NUMA: interleave - по очереди,\n"
+            "             local - на узле потока, который первым пишет в массив\n"
+            "  -M         сводка в stderr: байты массивов в страницах 4 КБ, 2 МБ и\n"
+            "             hugetlb и по узлам NUMA\n"
+            "  -D сокет   сервер на Unix-сокете: запрос - строка \"метод вход выход\"\n"
+            "             (вход и выход - text или binary), затем рёбра до конца\n"
+            "             потока; вход binary - пары int32 little-endian; клиент,\n"
+            "             молчащий или не читающий ответ дольше 30 с, отключается\n"
+            "  -j потоков число потоков сервера (по умолчанию 4)\n"
+            "  -o формат  text или binary (int32 little-endian)\n"
+            "  -w файл    файл для результата (по умолчанию stdout)\n"
+            "Без аргументов параметры запрашиваются интерактивно.\n",
+            name);
+}
+
+int main(int argc, char **argv) {
+    char filename_buf[100];
+    const char *filename = NULL, *manifest = NULL, *out_name = NULL, *socket_path = NULL;
+    int method = 0, storage = 0, format = 0, compact = 0, workers = 4;
+    int opt;
+
+    target_lists = malloc(argc * sizeof(char *));
+    while ((opt = getopt(argc, argv, "f:b:m:P:t:r:R:x:C:L:s:cuO:S:I:H:N:MD:j:o:w:h")) != -1) {
+        switch (opt) {
+        case 'f': filename = optarg; break;
+        case 'b': manifest = optarg; break;
+        case 'm':
+            method = parse_method(optarg);
+            if (!method) {
+                fprintf(stderr, "Неизвестный метод: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'P':
+            if (strcmp(optarg, "lex") == 0) {
+                priority_mode = PRIORITY_LEX;
+            } else if (strcmp(optarg, "critical") == 0) {
+                priority_mode = PRIORITY_CRITICAL;
+            } else {
+                priority_mode = PRIORITY_FILE;
+                priority_file = optarg;
+            }
+            if (!method)
+                method = 3;
+            break;
+        case 't': target_lists[target_list_count++] = optarg; break;
+        case 'r': reach_file = optarg; break;
+        case 'C': cache_dir = optarg; break;
+        case 'L':
+            cache_limit = (long long)(strtod(optarg, NULL) * (1 << 20));
+            if (cache_limit <= 0) {
+                fprintf(stderr, "Некорректный предел кэша: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'x':
+            external_budget = (long long)(strtod(optarg, NULL) * (1 << 20));
+            if (external_budget <= 0) {
+                fprintf(stderr, "Некорректный бюджет памяти: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'R':
+            if (strcmp(optarg, "auto") == 0) {
+                reach_kind = REACH_AUTO;
+            } else if (strcmp(optarg, "closure") == 0) {
+                reach_kind = REACH_CLOSURE;
+            } else if (strncmp(optarg, "grail", 5) == 0) {
+                reach_kind = REACH_GRAIL;
+                if (optarg[5] == ':')
+                    reach_labels = atoi(optarg + 6);
+                if (reach_labels <= 0 || (optarg[5] != ':' && optarg[5] != '\0')) {
+                    fprintf(stderr, "Неизвестный индекс: %s\n", optarg);
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Неизвестный индекс: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 's':
+            storage = parse_storage(optarg);
+            if (!storage) {
+                fprintf(stderr, "Неизвестный тип массива: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'c': compact = 1; break;
+        case 'u':
+            dedup_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+            if (dedup_threads < 1)
+                dedup_threads = 1;
+            break;
+        case 'O':
+            if (strcmp(optarg, "none") == 0) relabel_kind = RELABEL_NONE;
+            else if (strcmp(optarg, "bfs") == 0) relabel_kind = RELABEL_BFS;
+            else if (strcmp(optarg, "rcm") == 0) relabel_kind = RELABEL_RCM;
+            else if (strcmp(optarg, "degree") == 0) relabel_kind = RELABEL_DEGREE;
+            else {
+                fprintf(stderr, "Неизвестная перенумерация: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'S':
+            schedule = 1;
+            schedule_workers = atoi(optarg);
+            if (schedule_workers < 0) {
+                fprintf(stderr, "Некорректное число исполнителей: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'I':
+            if (strcmp(optarg, "stdio") == 0) ingest_mode = INGEST_STDIO;
+            else if (strcmp(optarg, "thread") == 0) ingest_mode = INGEST_THREAD;
+            else if (strcmp(optarg, "uring") == 0) ingest_mode = INGEST_URING;
+            else {
+                fprintf(stderr, "Неизвестный способ чтения: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'H':
+            if (strcmp(optarg, "thp") == 0) page_mode = PAGES_THP;
+            else if (strcmp(optarg, "huge") == 0) page_mode = PAGES_HUGETLB;
+            else {
+                fprintf(stderr, "Неизвестный вид страниц: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'N':
+            if (strcmp(optarg, "interleave") == 0) numa_mode = NUMA_INTERLEAVE;
+            else if (strcmp(optarg, "local") == 0) numa_mode = NUMA_LOCAL;
+            else {
+                fprintf(stderr, "Неизвестное размещение: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'M': memory_report = 1; break;
+        case 'D': socket_path = optarg; break;
+        case 'j':
+            workers = atoi(optarg);
+            if (workers <= 0) {
+                fprintf(stderr, "Некорректное число потоков: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'o':
+            if (strcmp(optarg, "text") == 0) format = 1;
+            else if (strcmp(optarg, "binary") == 0) format = 2;
+            else {
+                fprintf(stderr, "Неизвестный формат: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'w': out_name = optarg; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
     }
+    int interactive = argc == 1;
 
-    // Заполнение графа
-    for (int i = 0; i < edge_count; ++i) {
-        int u = edges[i].from;
-        int v = edges[i].to;
-        adj[u][v] = 1;
+    // Сервер: метод и форматы задаёт каждый запрос, по умолчанию CSR
+    if (socket_path) {
+        if (external_budget > 0 || cache_dir || schedule || memory_report
+            || storage == STORAGE_STATIC) {
+            fprintf(stderr, "Режим -D несовместим с -x, -C, -S, -M и статическим массивом\n");
+            return 1;
+        }
+        // Запросы и так сортируются параллельно, каждый - в одном потоке
+        if (dedup_threads > 0)
+            dedup_threads = 1;
+        int status = run_daemon(socket_path, workers, storage ? storage : STORAGE_SPARSE, compact);
+        free(target_lists);
+        return status;
     }
 
-    // Запуск нужного метода
-    if (method == 1)
-        top_sort_kahn(adj, vertex_count);
-    else
-        top_sort_tarjan(adj, vertex_count);
+    if (cache_dir && mkdir(cache_dir, 0755) != 0 && errno != EEXIST) {
+        perror(cache_dir);
+        return 1;
+    }
 
-    // Очистка
-    if (storage == 2) {
-        for (int i = 0; i < vertex_count; ++i)
-            free(adj[i]);
+    // Запросы достижимости задают вершины в номерах графа
+    if (relabel_kind != RELABEL_NONE && reach_file) {
+        fprintf(stderr, "Перенумерация -O несовместима с -r\n");
+        return 1;
     }
-    free(adj);
 
-    return 0;
+    // Расписание выводится текстом и строится в том же проходе, что и порядок Кана
+    if (schedule) {
+        if ((method && method != 1) || target_list_count || reach_file || external_budget > 0
+            || format == 2) {
+            fprintf(stderr, "Расписание -S поддерживает только метод Кана и текстовый вывод "
+                    "без -t, -r и -x\n");
+            return 1;
+        }
+        method = 1;
+    }
+
+    // Внешняя сортировка работает только с методом Кана и плотными номерами
+    if (external_budget > 0) {
+        if ((method && method != 1) || compact || target_list_count || reach_file || relabel_kind
+            || dedup_threads) {
+            fprintf(stderr, "Режим -x поддерживает только метод Кана без -c, -t, -r, -O и -u\n");
+            return 1;
+        }
+        method = 1;
+    }
+
+    if (!filename && !manifest) {
+        printf("Введите имя файла: ");
+        if (scanf("%99s", filename_buf) != 1)
+            input_ended();
+        filename = filename_buf;
+    }
+
+    // Ввод метода сортировки
+    while (!method && !target_list_count && !reach_file) {
+        printf("Выберите метод сортировки:\n1 - Кан\n2 - Тарьян\n3 - Кан с приоритетом (наименьший номер первым)\n> ");
+        if (scanf("%d", &method) != 1 || method < 1 || method > 3) {
+            printf("Некорректный ввод. Пожалуйста, введите 1, 2 или 3.\n");
+            skip_input_line();
+            method = 0;
+        }
+    }
+
+    // Ввод типа хранения
+    while (interactive && !storage) {
+        printf("Выберите тип массива:\n1 - Статический\n2 - Динамический\n"
+               "3 - Битовая матрица\n4 - Разреженный (CSR)\n5 - Сжатый (varint)\n> ");
+        if (scanf("%d", &storage) != 1 || storage < 1 || storage > 5) {
+            printf("Некорректный ввод. Пожалуйста, введите число от 1 до 5.\n");
+            skip_input_line();
+            storage = 0;
+        }
+    }
+    if (!storage)
+        storage = schedule ? STORAGE_SPARSE : STORAGE_DYNAMIC;
+
+    // Ввод формата вывода
+    while (interactive && !format) {
+        printf("Выберите формат вывода:\n1 - Текстовый\n2 - Двоичный (int32 little-endian)\n> ");
+        if (scanf("%d", &format) != 1 || (format != 1 && format != 2)) {
+            printf("Некорректный ввод. Пожалуйста, введите 1 или 2.\n");
+            skip_input_line();
+            format = 0;
+        }
+    }
+
+    char out_name_buf[100];
+    if (interactive && format == 2) {
+        printf("Введите имя файла для вывода: ");
+        if (scanf("%99s", out_name_buf) != 1)
+            input_ended();
+        out_name = out_name_buf;
+    }
+
+    if (out_name) {
+        out.fd = open(out_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out.fd < 0) {
+            perror("Ошибка при открытии файла вывода");
+            return 1;
+        }
+    }
+    if (format == 2)
+        out.format = compact ? OUT_BINARY64 : OUT_BINARY;
+
+    Workspace ws = {0};
+    int status;
+    if (manifest) {
+        out.framed = 1;
+        status = run_batch(manifest, method, storage, compact, &ws);
+    } else {
+        status = run_job(filename, method, storage, compact, &ws);
+    }
+
+    // Очистка; сводка -M считается при освобождении массивов
+    free_workspace(&ws);
+    if (memory_report)
+        mem_print_report();
+    free(target_lists);
+    free(out.buf);
+    if (out.fd != 1)
+        close(out.fd);
+
+    return status;
 }
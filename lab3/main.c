@@ -1,13 +1,139 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-#define MAX_EDGES 1000
+#define INITIAL_EDGES 1024
+#define OUT_BUF_SIZE (1 << 20)
 
 typedef struct {
     int from;
     int to;
 } Edge;
 
+typedef enum { OUT_TEXT, OUT_BINARY } OutFormat;
+
+// буферизованный вывод результата: один write на блок
+typedef struct {
+    int fd;
+    OutFormat format;
+    int framed;     // пакетный двоичный режим: перед порядком пишется его длина
+    size_t len;
+    char *buf;
+} OutWriter;
+
+// буфер отдельно от заголовка: в .bss, а не в инициализированных данных
+static char out_buf[OUT_BUF_SIZE];
+OutWriter out = { 1, OUT_TEXT, 0, 0, out_buf };
+
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// сброс буфера в файл
+void out_flush(OutWriter *w) {
+    if (w->fd == 1)
+        fflush(stdout); // сохраняем порядок с printf
+    size_t done = 0;
+    while (done < w->len) {
+        ssize_t n = write(w->fd, w->buf + done, w->len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("Ошибка записи результата");
+            break;
+        }
+        done += (size_t)n;
+    }
+    w->len = 0;
+}
+
+// вывод строки (только в текстовом режиме)
+void out_str(OutWriter *w, const char *s) {
+    if (w->format != OUT_TEXT) return;
+    size_t n = strlen(s);
+    while (n > 0) {
+        if (w->len == OUT_BUF_SIZE)
+            out_flush(w);
+        size_t chunk = OUT_BUF_SIZE - w->len;
+        if (chunk > n) chunk = n;
+        memcpy(w->buf + w->len, s, chunk);
+        w->len += chunk;
+        s += chunk;
+        n -= chunk;
+    }
+}
+
+// вывод числа: текстом через пробел или как int32 little-endian
+void out_int(OutWriter *w, long long x) {
+    if (w->len + 24 > OUT_BUF_SIZE)
+        out_flush(w);
+    char *p = w->buf + w->len;
+
+    if (w->format == OUT_BINARY) {
+        uint32_t u = (uint32_t)x;
+        p[0] = (char)(u & 0xff);
+        p[1] = (char)((u >> 8) & 0xff);
+        p[2] = (char)((u >> 16) & 0xff);
+        p[3] = (char)((u >> 24) & 0xff);
+        w->len += 4;
+        return;
+    }
+
+    char tmp[24];
+    int i = sizeof(tmp);
+    unsigned long long u = x < 0 ? 0ULL - (unsigned long long)x : (unsigned long long)x;
+    while (u >= 100) {
+        int d = (int)(u % 100) * 2;
+        u /= 100;
+        tmp[--i] = digit_pairs[d + 1];
+        tmp[--i] = digit_pairs[d];
+    }
+    if (u >= 10) {
+        int d = (int)u * 2;
+        tmp[--i] = digit_pairs[d + 1];
+        tmp[--i] = digit_pairs[d];
+    } else {
+        tmp[--i] = (char)('0' + u);
+    }
+    if (x < 0)
+        tmp[--i] = '-';
+
+    int n = sizeof(tmp) - i;
+    memcpy(p, tmp + i, n);
+    p[n] = ' ';
+    w->len += n + 1;
+}
+
+// начало результата: заголовок в текстовом режиме, длина в пакетном двоичном
+void out_begin(OutWriter *w, const char *title, int count) {
+    if (w->format == OUT_TEXT)
+        out_str(w, title);
+    else if (w->framed)
+        out_int(w, count);
+}
+
+// сообщение о цикле: в двоичном пакетном режиме - длина -1
+void out_cycle(OutWriter *w) {
+    if (w->format == OUT_TEXT) {
+        out_str(w, "Граф содержит цикл\n");
+        out_flush(w);
+    } else if (w->framed) {
+        out_int(w, -1);
+    } else {
+        fprintf(stderr, "Граф содержит цикл\n");
+    }
+}
+
+// завершение блока результата
+void out_end(OutWriter *w) {
+    out_str(w, "\n");
+    out_flush(w);
+}
+
 // структура узла кольцевой очереди
 typedef struct Node {
     int data;
@@ -72,6 +198,54 @@ int dequeue(Queue* Q) {
     return value;
 }
 
+// чтение рёбер из файла в переиспользуемый массив, который расширяется по мере заполнения
+// возвращает число рёбер или -1, если файл не открылся
+int read_edges(const char *filename, Edge **edges_buf, int *capacity) {
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        perror(filename);
+        return -1;
+    }
+
+    if (*capacity == 0) {
+        *capacity = INITIAL_EDGES;
+        *edges_buf = malloc(*capacity * sizeof(Edge));
+    }
+    Edge *edges = *edges_buf;
+    char line[256];
+    int line_number = 0;
+    int edge_count = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        line_number++;
+
+        // пропускаем пустые строки
+        if (line[0] == '\n' || line[0] == '\0') continue;
+
+        int u, v;
+        char extra;
+
+        int count = sscanf(line, "%d %d %c", &u, &v, &extra);
+        if (count < 2 || u < 0 || v < 0) {
+            fprintf(stderr, "Ошибка в строке %d: '%s'\n", line_number, line);
+            continue; // пропускаем некорректную строку
+        }
+
+        if (edge_count == *capacity) {
+            *capacity *= 2;
+            edges = realloc(edges, *capacity * sizeof(Edge));
+            *edges_buf = edges;
+        }
+
+        edges[edge_count].from = u;
+        edges[edge_count].to = v;
+        edge_count++;
+    }
+    fclose(f);
+
+    return edge_count;
+}
+
 // подсчёт количества вершин
 int find_vertex_count(Edge *edges, int edge_count) {
     int max = 0;
@@ -82,6 +256,60 @@ int find_vertex_count(Edge *edges, int edge_count) {
     return max + 1;
 }
 
+// выделение памяти для матрицы смежности и заполнение графа
+int **build_adj(Edge *edges, int edge_count, int vertex_count) {
+    int **adj = malloc(vertex_count * sizeof(int *));
+    for (int i = 0; i < vertex_count; ++i)
+        adj[i] = calloc(vertex_count, sizeof(int));
+
+    for (int i = 0; i < edge_count; ++i) {
+        int u = edges[i].from;
+        int v = edges[i].to;
+        adj[u][v] = 1;
+    }
+    return adj;
+}
+
+// освобождение матрицы смежности
+void free_adj(int **adj, int vertex_count) {
+    for (int i = 0; i < vertex_count; ++i)
+        free(adj[i]);
+    free(adj);
+}
+
+// буферы, переиспользуемые между заданиями пакетного режима
+typedef struct {
+    Edge *edges;
+    int edge_capacity;
+    int **adj;
+    int *cells;
+    int vertex_capacity;
+} Workspace;
+
+// матрица смежности в общем блоке рабочей области
+int **workspace_adj(Workspace *ws, int edge_count, int vertex_count) {
+    if (vertex_count > ws->vertex_capacity) {
+        free(ws->adj);
+        free(ws->cells);
+        ws->adj = malloc(vertex_count * sizeof(int *));
+        ws->cells = malloc((size_t)vertex_count * vertex_count * sizeof(int));
+        ws->vertex_capacity = vertex_count;
+    }
+    memset(ws->cells, 0, (size_t)vertex_count * vertex_count * sizeof(int));
+    for (int i = 0; i < vertex_count; ++i)
+        ws->adj[i] = ws->cells + (size_t)i * vertex_count;
+
+    for (int i = 0; i < edge_count; ++i)
+        ws->adj[ws->edges[i].from][ws->edges[i].to] = 1;
+    return ws->adj;
+}
+
+void free_workspace(Workspace *ws) {
+    free(ws->edges);
+    free(ws->adj);
+    free(ws->cells);
+}
+
 // топологическая сортировка методом Кана
 void top_sort_kahn(int **adj, int vertex_count) {
     int *in_degree = calloc(vertex_count, sizeof(int));
@@ -113,12 +341,12 @@ void top_sort_kahn(int **adj, int vertex_count) {
     }
 
     if (count != vertex_count) {
-        printf("Граф содержит цикл\n");
+        out_cycle(&out);
     } else {
-        printf("Результат (Кан): ");
+        out_begin(&out, "Результат (Кан): ", count);
         for (int i = 0; i < count; ++i)
-            printf("%d ", result[i]);
-        printf("\n");
+            out_int(&out, result[i]);
+        out_end(&out);
     }
 
     free(in_degree);
@@ -157,8 +385,8 @@ void print_stack_reverse(Queue *stack) {
         arr[i++] = dequeue(stack);
     }
     for (int j = i - 1; j >= 0; --j)
-        printf("%d ", arr[j]);
-    printf("\n");
+        out_int(&out, arr[j]);
+    out_end(&out);
     free(arr);
 }
 
@@ -173,95 +401,189 @@ void top_sort_tarjan(int **adj, int vertex_count) {
             dfs_tarjan(adj, i, visited, &stack, vertex_count);
 
     if (has_cycle) {
-        printf("Граф содержит цикл\n");
+        out_cycle(&out);
     } else {
-        printf("Результат (Тарьян): ");
+        out_begin(&out, "Результат (Тарьян): ", vertex_count);
         print_stack_reverse(&stack);
     }
 
     free(visited);
 }
 
-int main() {
-    char filename[100];
-    int method = 0;
-
-    printf("Введите имя файла: ");
-    scanf("%s", filename);
+// одно задание: чтение файла, построение графа и сортировка
+int run_job(const char *filename, int method, Workspace *ws) {
+    int edge_count = read_edges(filename, &ws->edges, &ws->edge_capacity);
+    if (edge_count < 0)
+        return 1;
 
-    // ввод метода сортировки
-    while (1) {
-        printf("Выберите метод сортировки:\n1 - Кан\n2 - Тарьян\n> ");
-        if (scanf("%d", &method) != 1 || (method != 1 && method != 2)) {
-            printf("Некорректный ввод. Пожалуйста, введите 1 или 2.\n");
-            while (getchar() != '\n');
-        } else break;
+    if (edge_count == 0) {
+        fprintf(stderr, "Файл %s не содержит корректных рёбер\n", filename);
+        return 1;
     }
 
-    FILE *f = fopen(filename, "r");
+    int vertex_count = find_vertex_count(ws->edges, edge_count);
+    int **adj = workspace_adj(ws, edge_count, vertex_count);
+
+    if (method == 1)
+        top_sort_kahn(adj, vertex_count);
+    else
+        top_sort_tarjan(adj, vertex_count);
+    return 0;
+}
+
+// пакетный режим: список файлов графов, по одному на строку
+int run_batch(const char *manifest, int method, Workspace *ws) {
+    FILE *f = fopen(manifest, "r");
     if (!f) {
-        perror("Ошибка при открытии файла");
+        perror(manifest);
         return 1;
     }
 
-    Edge edges[MAX_EDGES];
-    int edge_count = 0;
-    char line[256];
-    int line_number = 0;
-
+    char line[4096];
+    int failed = 0;
     while (fgets(line, sizeof(line), f)) {
-        line_number++;
-        // пропускаем пустые строки
-        if (line[0] == '\n' || line[0] == '\0') continue;
+        line[strcspn(line, "\r\n")] = '\0';
+        // пропускаем пустые строки и комментарии
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        out_str(&out, "# ");
+        out_str(&out, line);
+        out_str(&out, "\n");
+        if (run_job(line, method, ws) != 0) {
+            failed++;
+            if (out.format == OUT_BINARY)
+                out_int(&out, -2); // задание не выполнено
+        }
+    }
+    fclose(f);
+    out_flush(&out);
+    return failed ? 1 : 0;
+}
 
-        int u, v;
-        char extra;
+// разбор названия метода: 1 - Кан, 2 - Тарьян, 0 - ошибка
+int parse_method(const char *s) {
+    if (strcmp(s, "1") == 0 || strcmp(s, "kahn") == 0) return 1;
+    if (strcmp(s, "2") == 0 || strcmp(s, "tarjan") == 0) return 2;
+    return 0;
+}
 
-        int count = sscanf(line, "%d %d %c", &u, &v, &extra);
-        if (count < 2 || u < 0 || v < 0) {
-            printf("Ошибка в строке %d: '%s'\n", line_number, line);
-            continue; // пропускаем некорректную строку
-        }
+// конец ввода во время вопросов: ответа уже не будет
+void input_ended(void) {
+    fprintf(stderr, "Ввод закончился, параметры не заданы\n");
+    exit(1);
+}
+
+// очистка ввода до конца строки после некорректного ответа
+void skip_input_line(void) {
+    int ch;
+    while ((ch = getchar()) != '\n')
+        if (ch == EOF)
+            input_ended();
+}
 
-        if (edge_count >= MAX_EDGES) {
-            printf("Превышено допустимое количество рёбер (%d)\n", MAX_EDGES);
+void usage(const char *name) {
+    fprintf(stderr,
+            "Использование: %s [-f файл | -b список] [-m kahn|tarjan] [-o text|binary] [-w файл]\n"
+            "  -f файл    файл с рёбрами графа\n"
+            "  -b список  пакетный режим: файл со списком графов, по одному на строку\n"
+            "  -m метод   kahn (1) или tarjan (2)\n"
+            "  -o формат  text или binary (int32 little-endian)\n"
+            "  -w файл    файл для результата (по умолчанию stdout)\n"
+            "Без аргументов параметры запрашиваются интерактивно.\n",
+            name);
+}
+
+int main(int argc, char **argv) {
+    char filename_buf[100];
+    const char *filename = NULL, *manifest = NULL, *out_name = NULL;
+    int method = 0, format = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:b:m:o:w:h")) != -1) {
+        switch (opt) {
+        case 'f': filename = optarg; break;
+        case 'b': manifest = optarg; break;
+        case 'm':
+            method = parse_method(optarg);
+            if (!method) {
+                fprintf(stderr, "Неизвестный метод: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'o':
+            if (strcmp(optarg, "text") == 0) format = 1;
+            else if (strcmp(optarg, "binary") == 0) format = 2;
+            else {
+                fprintf(stderr, "Неизвестный формат: %s\n", optarg);
+                return 1;
+            }
             break;
+        case 'w': out_name = optarg; break;
+        default:
+            usage(argv[0]);
+            return 1;
         }
-
-        edges[edge_count].from = u;
-        edges[edge_count].to = v;
-        edge_count++;
     }
-    fclose(f);
+    int interactive = argc == 1;
 
-    if (edge_count == 0) {
-        printf("Файл не содержит корректных рёбер. Завершение программы.\n");
-        return 1;
+    if (!filename && !manifest) {
+        printf("Введите имя файла: ");
+        if (scanf("%99s", filename_buf) != 1)
+            input_ended();
+        filename = filename_buf;
     }
 
-    int vertex_count = find_vertex_count(edges, edge_count);
+    // ввод метода сортировки
+    while (!method) {
+        printf("Выберите метод сортировки:\n1 - Кан\n2 - Тарьян\n> ");
+        if (scanf("%d", &method) != 1 || (method != 1 && method != 2)) {
+            printf("Некорректный ввод. Пожалуйста, введите 1 или 2.\n");
+            skip_input_line();
+            method = 0;
+        }
+    }
 
-    // выделение памяти для матрицы смежности
-    int **adj = malloc(vertex_count * sizeof(int *));
-    for (int i = 0; i < vertex_count; ++i)
-        adj[i] = calloc(vertex_count, sizeof(int));
+    // ввод формата вывода
+    while (interactive && !format) {
+        printf("Выберите формат вывода:\n1 - Текстовый\n2 - Двоичный (int32 little-endian)\n> ");
+        if (scanf("%d", &format) != 1 || (format != 1 && format != 2)) {
+            printf("Некорректный ввод. Пожалуйста, введите 1 или 2.\n");
+            skip_input_line();
+            format = 0;
+        }
+    }
 
-    // заполнение графа
-    for (int i = 0; i < edge_count; ++i) {
-        int u = edges[i].from;
-        int v = edges[i].to;
-        adj[u][v] = 1;
+    char out_name_buf[100];
+    if (interactive && format == 2) {
+        printf("Введите имя файла для вывода: ");
+        if (scanf("%99s", out_name_buf) != 1)
+            input_ended();
+        out_name = out_name_buf;
     }
 
-    if (method == 1)
-        top_sort_kahn(adj, vertex_count);
-    else
-        top_sort_tarjan(adj, vertex_count);
+    if (out_name) {
+        out.fd = open(out_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out.fd < 0) {
+            perror("Ошибка при открытии файла вывода");
+            return 1;
+        }
+    }
+    if (format == 2)
+        out.format = OUT_BINARY;
+
+    Workspace ws = {0};
+    int status;
+    if (manifest) {
+        out.framed = 1;
+        status = run_batch(manifest, method, &ws);
+    } else {
+        status = run_job(filename, method, &ws);
+    }
 
     // очистка памяти
-    for (int i = 0; i < vertex_count; ++i)
-        free(adj[i]);
-    free(adj);
+    free_workspace(&ws);
+    if (out.fd != 1)
+        close(out.fd);
 
-    return 0;
+    return status;
 }
@@ -1,15 +1,217 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
-#define MAX_EDGES 1000
+#include <stdint.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define INITIAL_EDGES 1024
 #define ALPHABET_SIZE 256
+#define RMQ_BLOCK 64    // позиций суффиксного массива на блок разреженной таблицы
+#define OUT_BUF_SIZE (1 << 20)
 
 typedef struct {
     int from;
     int to;
 } Edge;
 
+// ---- инструментирование: собирается только с -DSTATS ----
+#ifdef STATS
+#include <time.h>
+
+typedef struct {
+    // длительности этапов, с
+    double parse, build, kahn, tarjan, output, tree, index, search, total;
+    double prompt;      // ожидание ввода шаблона, в total не входит
+    // счётчики
+    long long edges_parsed, lines_rejected;
+    long long queue_pushes, dfs_depth, dfs_max_depth;
+    long long rotations, bm_comparisons, bm_shifts, index_bytes;
+} Stats;
+
+Stats stats;
+
+double stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#define STAGE_BEGIN(name) double stage_##name = stats_now()
+#define STAGE_END(name) (stats.name += stats_now() - stage_##name)
+#define STAT_ADD(field, n) (stats.field += (n))
+#define STAT_DFS_ENTER() \
+    do { if (++stats.dfs_depth > stats.dfs_max_depth) stats.dfs_max_depth = stats.dfs_depth; } while (0)
+#define STAT_DFS_LEAVE() (stats.dfs_depth--)
+
+// отчёт: в JSON-файл из LAB_STATS_JSON или текстом в stderr
+void stats_report(void) {
+    stats.total -= stats.prompt;
+    const char *path = getenv("LAB_STATS_JSON");
+    FILE *f = path ? fopen(path, "w") : NULL;
+    if (f) {
+        fprintf(f, "{\n  \"seconds\": {\"parse\": %.9f, \"build\": %.9f, \"kahn\": %.9f, "
+                "\"tarjan\": %.9f, \"output\": %.9f, \"tree\": %.9f, \"index\": %.9f, "
+                "\"search\": %.9f, \"total\": %.9f},\n",
+                stats.parse, stats.build, stats.kahn, stats.tarjan, stats.output,
+                stats.tree, stats.index, stats.search, stats.total);
+        fprintf(f, "  \"counters\": {\"edges_parsed\": %lld, \"lines_rejected\": %lld, "
+                "\"queue_pushes\": %lld, \"dfs_max_depth\": %lld, \"rotations\": %lld, "
+                "\"bm_comparisons\": %lld, \"bm_shifts\": %lld, \"index_bytes\": %lld}\n}\n",
+                stats.edges_parsed, stats.lines_rejected, stats.queue_pushes,
+                stats.dfs_max_depth, stats.rotations, stats.bm_comparisons, stats.bm_shifts,
+                stats.index_bytes);
+        fclose(f);
+        return;
+    }
+    fprintf(stderr, "---- статистика ----\n");
+    fprintf(stderr, "разбор:      %.6f с (рёбер %lld, отброшено строк %lld)\n",
+            stats.parse, stats.edges_parsed, stats.lines_rejected);
+    fprintf(stderr, "построение:  %.6f с\n", stats.build);
+    fprintf(stderr, "Кан:         %.6f с (вставок в очередь %lld)\n", stats.kahn, stats.queue_pushes);
+    fprintf(stderr, "Тарьян:      %.6f с (макс. глубина DFS %lld)\n", stats.tarjan, stats.dfs_max_depth);
+    fprintf(stderr, "вывод:       %.6f с\n", stats.output);
+    fprintf(stderr, "дерево:      %.6f с (поворотов %lld)\n", stats.tree, stats.rotations);
+    fprintf(stderr, "индекс:      %.6f с (%lld байт)\n", stats.index, stats.index_bytes);
+    fprintf(stderr, "поиск:       %.6f с (сравнений %lld, сдвигов %lld)\n",
+            stats.search, stats.bm_comparisons, stats.bm_shifts);
+    fprintf(stderr, "всего:       %.6f с\n", stats.total);
+}
+#else
+#define STAGE_BEGIN(name) ((void)0)
+#define STAGE_END(name) ((void)0)
+#define STAT_ADD(field, n) ((void)0)
+#define STAT_DFS_ENTER() ((void)0)
+#define STAT_DFS_LEAVE() ((void)0)
+#define stats_report() ((void)0)
+#endif
+
+typedef enum { OUT_TEXT, OUT_BINARY } OutFormat;
+
+// буферизованный вывод результата: один write на блок
+typedef struct {
+    int fd;
+    OutFormat format;
+    int framed;     // пакетный двоичный режим: перед порядком пишется его длина
+    size_t len;
+    char *buf;
+} OutWriter;
+
+// буфер отдельно от заголовка: в .bss, а не в инициализированных данных
+static char out_buf[OUT_BUF_SIZE];
+OutWriter out = { 1, OUT_TEXT, 0, 0, out_buf };
+
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// сброс буфера в файл
+void out_flush(OutWriter *w) {
+    if (w->fd == 1)
+        fflush(stdout); // сохраняем порядок с printf
+    size_t done = 0;
+    while (done < w->len) {
+        ssize_t n = write(w->fd, w->buf + done, w->len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("Ошибка записи результата");
+            break;
+        }
+        done += (size_t)n;
+    }
+    w->len = 0;
+}
+
+// вывод строки (только в текстовом режиме)
+void out_str(OutWriter *w, const char *s) {
+    if (w->format != OUT_TEXT) return;
+    size_t n = strlen(s);
+    while (n > 0) {
+        if (w->len == OUT_BUF_SIZE)
+            out_flush(w);
+        size_t chunk = OUT_BUF_SIZE - w->len;
+        if (chunk > n) chunk = n;
+        memcpy(w->buf + w->len, s, chunk);
+        w->len += chunk;
+        s += chunk;
+        n -= chunk;
+    }
+}
+
+// вывод числа: текстом через пробел или как int32 little-endian
+void out_int(OutWriter *w, long long x) {
+    if (w->len + 24 > OUT_BUF_SIZE)
+        out_flush(w);
+    char *p = w->buf + w->len;
+
+    if (w->format == OUT_BINARY) {
+        uint32_t u = (uint32_t)x;
+        p[0] = (char)(u & 0xff);
+        p[1] = (char)((u >> 8) & 0xff);
+        p[2] = (char)((u >> 16) & 0xff);
+        p[3] = (char)((u >> 24) & 0xff);
+        w->len += 4;
+        return;
+    }
+
+    char tmp[24];
+    int i = sizeof(tmp);
+    unsigned long long u = x < 0 ? 0ULL - (unsigned long long)x : (unsigned long long)x;
+    while (u >= 100) {
+        int d = (int)(u % 100) * 2;
+        u /= 100;
+        tmp[--i] = digit_pairs[d + 1];
+        tmp[--i] = digit_pairs[d];
+    }
+    if (u >= 10) {
+        int d = (int)u * 2;
+        tmp[--i] = digit_pairs[d + 1];
+        tmp[--i] = digit_pairs[d];
+    } else {
+        tmp[--i] = (char)('0' + u);
+    }
+    if (x < 0)
+        tmp[--i] = '-';
+
+    int n = sizeof(tmp) - i;
+    memcpy(p, tmp + i, n);
+    p[n] = ' ';
+    w->len += n + 1;
+}
+
+// начало результата: заголовок в текстовом режиме, длина в пакетном двоичном
+void out_begin(OutWriter *w, const char *title, int count) {
+    if (w->format == OUT_TEXT)
+        out_str(w, title);
+    else if (w->framed)
+        out_int(w, count);
+}
+
+// сообщение о цикле: в двоичном пакетном режиме - длина -1
+void out_cycle(OutWriter *w) {
+    if (w->format == OUT_TEXT) {
+        out_str(w, "Граф содержит цикл\n");
+        out_flush(w);
+    } else if (w->framed) {
+        out_int(w, -1);
+    } else {
+        fprintf(stderr, "Граф содержит цикл\n");
+    }
+}
+
+// завершение блока результата
+void out_end(OutWriter *w) {
+    out_str(w, "\n");
+    out_flush(w);
+}
+
 typedef enum { RED, BLACK } Color;
 
 // узел красно-чёрного дерева
@@ -35,6 +237,7 @@ void init_rbtree(RBTree* tree) {
 
 // поворот поддерева влево
 void left_rotate(RBTree* tree, TreeNode* x) {
+    STAT_ADD(rotations, 1);
     TreeNode* y = x->right;
     x->right = y->left;
 
@@ -56,6 +259,7 @@ void left_rotate(RBTree* tree, TreeNode* x) {
 
 // поворот поддерева вправо
 void right_rotate(RBTree* tree, TreeNode* y) {
+    STAT_ADD(rotations, 1);
     TreeNode* x = y->left;
     y->left = x->right;
 
@@ -144,6 +348,441 @@ void insert_rbtree(RBTree* tree, long long value) {
     insert_fixup(tree, z);
 }
 
+// поиск элемента, nil - если не найден
+TreeNode* search_rbtree(RBTree* tree, long long value) {
+    TreeNode* x = tree->root;
+    while (x != tree->nil && x->data != value)
+        x = value < x->data ? x->left : x->right;
+    return x;
+}
+
+// ---- персистентное красно-чёрное дерево: вставка копирует только путь от корня,
+// новый корень публикуется атомарно, читатели работают без блокировок ----
+
+#define PTREE_READERS 64
+#define PTREE_RECLAIM_BATCH 1024
+
+// узел персистентного дерева не меняется после публикации
+typedef struct PNode {
+    long long data;
+    Color color;
+    int size;   // число узлов поддерева: по нему читатель проверяет снимок
+    struct PNode *left, *right;
+} PNode;
+
+// эпоха, в которой читатель взял корень; 0 - читатель неактивен
+typedef struct {
+    _Atomic unsigned long long epoch;
+    char pad[64 - sizeof(unsigned long long)];
+} ReaderSlot;
+
+// заменённый узел и эпоха, в которой он стал недостижим из нового корня
+typedef struct {
+    PNode *node;
+    unsigned long long epoch;
+} Retired;
+
+typedef struct {
+    _Atomic(PNode *) root;
+    _Atomic unsigned long long epoch;
+    _Atomic int reader_count;
+    ReaderSlot readers[PTREE_READERS];
+    // заменённые узлы в порядке эпох, освобождает только писатель
+    Retired *retired;
+    size_t retired_head, retired_len, retired_capacity;
+    long long allocated, freed;
+} PTree;
+
+void init_ptree(PTree* tree) {
+    atomic_init(&tree->root, NULL);
+    atomic_init(&tree->epoch, 1);
+    atomic_init(&tree->reader_count, 0);
+    for (int i = 0; i < PTREE_READERS; i++)
+        atomic_init(&tree->readers[i].epoch, 0);
+    tree->retired = NULL;
+    tree->retired_head = tree->retired_len = tree->retired_capacity = 0;
+    tree->allocated = tree->freed = 0;
+}
+
+// регистрация потока-читателя, возвращает номер слота или -1
+int ptree_reader_register(PTree* tree) {
+    int slot = atomic_fetch_add(&tree->reader_count, 1);
+    return slot < PTREE_READERS ? slot : -1;
+}
+
+// начало чтения: читатель объявляет эпоху и берёт текущий снимок
+PNode* ptree_read_begin(PTree* tree, int slot) {
+    atomic_store(&tree->readers[slot].epoch, atomic_load(&tree->epoch));
+    return atomic_load(&tree->root);
+}
+
+// конец чтения: узлы снимка больше не используются
+void ptree_read_end(PTree* tree, int slot) {
+    atomic_store_explicit(&tree->readers[slot].epoch, 0, memory_order_release);
+}
+
+// поиск в снимке
+int ptree_search(const PNode* x, long long value) {
+    while (x && x->data != value)
+        x = value < x->data ? x->left : x->right;
+    return x != NULL;
+}
+
+int pnode_size(const PNode* x) {
+    return x ? x->size : 0;
+}
+
+// копия узла пути; оригинал уходит в список заменённых
+PNode* pnode_copy(PTree* tree, PNode* h) {
+    PNode* n = malloc(sizeof(PNode));
+    *n = *h;
+    tree->allocated++;
+    if (tree->retired_len == tree->retired_capacity) {
+        // сдвигаем живую часть в начало, при нехватке места расширяем
+        if (tree->retired_head > tree->retired_len / 2) {
+            memmove(tree->retired, tree->retired + tree->retired_head,
+                    (tree->retired_len - tree->retired_head) * sizeof(Retired));
+            tree->retired_len -= tree->retired_head;
+            tree->retired_head = 0;
+        } else {
+            tree->retired_capacity = tree->retired_capacity ? tree->retired_capacity * 2 : 1024;
+            tree->retired = realloc(tree->retired, tree->retired_capacity * sizeof(Retired));
+        }
+    }
+    // эпоха уточняется после публикации корня
+    tree->retired[tree->retired_len].node = h;
+    tree->retired[tree->retired_len].epoch = 0;
+    tree->retired_len++;
+    return n;
+}
+
+void pnode_update(PNode* x) {
+    x->size = 1 + pnode_size(x->left) + pnode_size(x->right);
+}
+
+// балансировка Окасаки: красный узел с красным потомком под чёрным узлом
+// превращается в красный узел с двумя чёрными детьми. Все три узла лежат на
+// скопированном пути и ещё не опубликованы, поэтому меняются на месте
+PNode* pnode_balance(PNode* n) {
+    if (n->color != BLACK)
+        return n;
+    PNode *x, *y, *z;
+    if (n->left && n->left->color == RED && n->left->left && n->left->left->color == RED) {
+        x = n->left->left; y = n->left; z = n;
+        z->left = y->right;
+    } else if (n->left && n->left->color == RED && n->left->right && n->left->right->color == RED) {
+        x = n->left; y = n->left->right; z = n;
+        x->right = y->left;
+        z->left = y->right;
+    } else if (n->right && n->right->color == RED && n->right->left && n->right->left->color == RED) {
+        x = n; y = n->right->left; z = n->right;
+        x->right = y->left;
+        z->left = y->right;
+    } else if (n->right && n->right->color == RED && n->right->right && n->right->right->color == RED) {
+        x = n; y = n->right; z = n->right->right;
+        x->right = y->left;
+    } else {
+        return n;
+    }
+    STAT_ADD(rotations, 1);
+    y->left = x;
+    y->right = z;
+    x->color = z->color = BLACK;
+    y->color = RED;
+    pnode_update(x);
+    pnode_update(z);
+    pnode_update(y);
+    return y;
+}
+
+PNode* pnode_insert(PTree* tree, PNode* h, long long value) {
+    if (!h) {
+        PNode* n = malloc(sizeof(PNode));
+        n->data = value;
+        n->color = RED;
+        n->size = 1;
+        n->left = n->right = NULL;
+        tree->allocated++;
+        return n;
+    }
+    PNode* n = pnode_copy(tree, h);
+    if (value < h->data)
+        n->left = pnode_insert(tree, h->left, value);
+    else
+        n->right = pnode_insert(tree, h->right, value);
+    n->size++;
+    return pnode_balance(n);
+}
+
+// освобождение заменённых узлов, которые не видит ни один активный читатель
+void ptree_reclaim(PTree* tree) {
+    unsigned long long min_epoch = ~0ULL;
+    for (int i = 0; i < PTREE_READERS; i++) {
+        unsigned long long e = atomic_load(&tree->readers[i].epoch);
+        if (e && e < min_epoch)
+            min_epoch = e;
+    }
+    while (tree->retired_head < tree->retired_len &&
+           tree->retired[tree->retired_head].epoch < min_epoch) {
+        free(tree->retired[tree->retired_head].node);
+        tree->retired_head++;
+        tree->freed++;
+    }
+    if (tree->retired_head == tree->retired_len)
+        tree->retired_head = tree->retired_len = 0;
+}
+
+// вставка единственным писателем: новый путь, публикация корня, смена эпохи
+void insert_ptree(PTree* tree, long long value) {
+    PNode* old_root = atomic_load_explicit(&tree->root, memory_order_relaxed);
+    // при копировании список может сдвинуться к началу, поэтому запоминаем
+    // не индекс, а число уже ожидающих узлов
+    size_t pending = tree->retired_len - tree->retired_head;
+    PNode* root = pnode_insert(tree, old_root, value);
+    root->color = BLACK;
+    atomic_store(&tree->root, root);
+
+    // заменённые узлы недостижимы для читателей, взявших эпоху позже текущей
+    unsigned long long e = atomic_fetch_add(&tree->epoch, 1);
+    for (size_t i = tree->retired_head + pending; i < tree->retired_len; i++)
+        tree->retired[i].epoch = e;
+    if (tree->retired_len - tree->retired_head >= PTREE_RECLAIM_BATCH)
+        ptree_reclaim(tree);
+}
+
+void pnode_free(PNode* x) {
+    if (!x) return;
+    pnode_free(x->left);
+    pnode_free(x->right);
+    free(x);
+}
+
+// освобождение всех версий, читателей уже нет
+void free_ptree(PTree* tree) {
+    for (size_t i = tree->retired_head; i < tree->retired_len; i++)
+        free(tree->retired[i].node);
+    free(tree->retired);
+    pnode_free(atomic_load(&tree->root));
+    atomic_store(&tree->root, NULL);
+}
+
+// обход дерева по возрастанию: значения пишутся в out, возвращается их число
+int inorder_rbtree(RBTree* tree, long long* out) {
+    // высота красно-чёрного дерева не больше 2 log2(n + 1)
+    TreeNode* stack[128];
+    int top = 0, count = 0;
+    TreeNode* x = tree->root;
+    while (x != tree->nil || top > 0) {
+        while (x != tree->nil) {
+            stack[top++] = x;
+            x = x->left;
+        }
+        x = stack[--top];
+        out[count++] = x->data;
+        x = x->right;
+    }
+    return count;
+}
+
+// ---- B+-дерево: ключи узла занимают ровно одну строку кэша ----
+
+#define BPT_KEYS 16
+
+// ключи - номера вершин (int), 16 штук ровно в 64 байтах
+typedef struct BPNode {
+    int keys[BPT_KEYS];
+    int count;
+    int leaf;
+    struct BPNode *next;    // следующий лист для обхода диапазона
+} BPNode;
+
+// внутренний узел: дети хранятся после ключей, у листов их нет
+typedef struct {
+    BPNode node;
+    BPNode *children[BPT_KEYS + 1];
+} BPInner;
+
+#define BPT_CHILDREN(n) (((BPInner*)(n))->children)
+
+typedef struct {
+    BPNode* root;
+    int height;
+    long long size;
+    long long bytes;
+} BPTree;
+
+#define BPT_LEAF_BYTES ((sizeof(BPNode) + 63) / 64 * 64)
+#define BPT_INNER_BYTES ((sizeof(BPInner) + 63) / 64 * 64)
+
+BPNode* bpt_node_new(BPTree* tree, int leaf) {
+    size_t bytes = leaf ? BPT_LEAF_BYTES : BPT_INNER_BYTES;
+    BPNode* n = aligned_alloc(64, bytes);
+    n->count = 0;
+    n->leaf = leaf;
+    n->next = NULL;
+    tree->bytes += bytes;
+    return n;
+}
+
+void init_bptree(BPTree* tree) {
+    tree->bytes = 0;
+    tree->root = bpt_node_new(tree, 1);
+    tree->height = 1;
+    tree->size = 0;
+}
+
+// число ключей узла меньше x (inclusive = 0) или не больше x (inclusive = 1)
+static inline int bpt_rank(const BPNode* n, int x, int inclusive) {
+#ifdef __SSE2__
+    // четыре сравнения по 4 ключа, маска битов по одному на ключ
+    __m128i v = _mm_set1_epi32(x);
+    unsigned mask = 0;
+    for (int i = 0; i < BPT_KEYS; i += 4) {
+        __m128i k = _mm_load_si128((const __m128i*)(n->keys + i));
+        __m128i c = inclusive ? _mm_cmpgt_epi32(k, v) : _mm_cmplt_epi32(k, v);
+        mask |= (unsigned)_mm_movemask_ps(_mm_castsi128_ps(c)) << i;
+    }
+    unsigned valid = (1u << n->count) - 1;
+    return __builtin_popcount((inclusive ? ~mask : mask) & valid);
+#else
+    int r = 0;
+    for (int i = 0; i < n->count; i++)
+        r += inclusive ? n->keys[i] <= x : n->keys[i] < x;
+    return r;
+#endif
+}
+
+// вставка в поддерево n; если узел разделился, возвращает 1, в *up - разделитель,
+// в *right - новый правый узел
+int bpt_insert_node(BPTree* tree, BPNode* n, int x, int* up, BPNode** right) {
+    // равные ключи идут после уже вставленных, как в insert_rbtree
+    int pos = bpt_rank(n, x, 1);
+    int key = x;
+    BPNode* child = NULL;
+    if (!n->leaf) {
+        if (!bpt_insert_node(tree, BPT_CHILDREN(n)[pos], x, &key, &child))
+            return 0;
+    }
+
+    if (n->count < BPT_KEYS) {
+        memmove(n->keys + pos + 1, n->keys + pos, (n->count - pos) * sizeof(int));
+        n->keys[pos] = key;
+        if (!n->leaf) {
+            memmove(BPT_CHILDREN(n) + pos + 2, BPT_CHILDREN(n) + pos + 1,
+                    (n->count - pos) * sizeof(BPNode*));
+            BPT_CHILDREN(n)[pos + 1] = child;
+        }
+        n->count++;
+        return 0;
+    }
+
+    // узел полон: 17 ключей делятся пополам
+    int keys[BPT_KEYS + 1];
+    BPNode* children[BPT_KEYS + 2];
+    memcpy(keys, n->keys, pos * sizeof(int));
+    keys[pos] = key;
+    memcpy(keys + pos + 1, n->keys + pos, (BPT_KEYS - pos) * sizeof(int));
+    if (!n->leaf) {
+        memcpy(children, BPT_CHILDREN(n), (pos + 1) * sizeof(BPNode*));
+        children[pos + 1] = child;
+        memcpy(children + pos + 2, BPT_CHILDREN(n) + pos + 1, (BPT_KEYS - pos) * sizeof(BPNode*));
+    }
+
+    // ключ в конце листа (вставка по возрастанию): левый лист остаётся полным
+    int half = n->leaf && pos == BPT_KEYS ? BPT_KEYS : (BPT_KEYS + 1) / 2;
+    BPNode* r = bpt_node_new(tree, n->leaf);
+    if (n->leaf) {
+        // лист: разделитель остаётся первым ключом правого листа
+        n->count = half;
+        r->count = BPT_KEYS + 1 - half;
+        memcpy(n->keys, keys, half * sizeof(int));
+        memcpy(r->keys, keys + half, r->count * sizeof(int));
+        r->next = n->next;
+        n->next = r;
+        *up = r->keys[0];
+    } else {
+        // внутренний узел: средний ключ уходит наверх
+        n->count = half;
+        r->count = BPT_KEYS - half;
+        memcpy(n->keys, keys, half * sizeof(int));
+        memcpy(BPT_CHILDREN(n), children, (half + 1) * sizeof(BPNode*));
+        memcpy(r->keys, keys + half + 1, r->count * sizeof(int));
+        memcpy(BPT_CHILDREN(r), children + half + 1, (r->count + 1) * sizeof(BPNode*));
+        *up = keys[half];
+    }
+    *right = r;
+    return 1;
+}
+
+// вставка элемента
+void insert_bptree(BPTree* tree, int value) {
+    int up;
+    BPNode* right;
+    if (bpt_insert_node(tree, tree->root, value, &up, &right)) {
+        BPNode* root = bpt_node_new(tree, 0);
+        root->keys[0] = up;
+        BPT_CHILDREN(root)[0] = tree->root;
+        BPT_CHILDREN(root)[1] = right;
+        root->count = 1;
+        tree->root = root;
+        tree->height++;
+    }
+    tree->size++;
+}
+
+// лист и позиция первого ключа не меньше x; NULL, если такого нет
+BPNode* bpt_lower_bound(const BPTree* tree, int x, int* pos) {
+    BPNode* n = tree->root;
+    while (!n->leaf)
+        n = BPT_CHILDREN(n)[bpt_rank(n, x, 0)];
+    int i = bpt_rank(n, x, 0);
+    // все ключи листа меньше x: ответ - первый ключ следующего листа
+    while (n && i == n->count) {
+        n = n->next;
+        i = 0;
+    }
+    *pos = i;
+    return n;
+}
+
+// поиск элемента: 1 - найден
+int search_bptree(const BPTree* tree, int value) {
+    int pos;
+    BPNode* n = bpt_lower_bound(tree, value, &pos);
+    return n && n->keys[pos] == value;
+}
+
+// ключи из [lo, hi] по возрастанию по связанным листам, не больше cap штук
+int range_bptree(const BPTree* tree, int lo, int hi, long long* out, int cap) {
+    int pos, count = 0;
+    BPNode* n = bpt_lower_bound(tree, lo, &pos);
+    for (; n && count < cap; n = n->next, pos = 0) {
+        for (; pos < n->count && count < cap; pos++) {
+            if (n->keys[pos] > hi)
+                return count;
+            out[count++] = n->keys[pos];
+        }
+    }
+    return count;
+}
+
+// обход дерева по возрастанию
+int inorder_bptree(const BPTree* tree, long long* out) {
+    return range_bptree(tree, INT_MIN, INT_MAX, out, (int)tree->size);
+}
+
+void bpt_node_free(BPNode* n) {
+    if (!n->leaf)
+        for (int i = 0; i <= n->count; i++)
+            bpt_node_free(BPT_CHILDREN(n)[i]);
+    free(n);
+}
+
+void free_bptree(BPTree* tree) {
+    bpt_node_free(tree->root);
+    tree->root = NULL;
+}
+
 // создание таблицы плохих символов
 void bad_char(const char* pat, int m, int badchar[ALPHABET_SIZE]) {
     for (int i = 0; i < ALPHABET_SIZE; i++)
@@ -185,8 +824,11 @@ void good_suffix(int* shift, int* bpos, const char* pat, int m) {
 }
 
 // поиск Бойера-Мура
-int boyer_moore_search(const char* text, const char* pattern) {
+// возвращает позицию первого вхождения или -1; если count не NULL,
+// просмотр идёт до конца текста и в count записывается число всех вхождений
+int boyer_moore_search(const char* text, const char* pattern, long long* count) {
     int m = strlen(pattern), n = strlen(text);
+    if (count) *count = 0;
     if (m == 0 || n < m) return -1;
 
     int badchar[ALPHABET_SIZE];
@@ -196,21 +838,389 @@ int boyer_moore_search(const char* text, const char* pattern) {
     int* shift = malloc((m + 1) * sizeof(int));
     good_suffix(shift, bpos, pattern, m);
 
-    int s = 0;
+    STAGE_BEGIN(search);
+    int s = 0, first = -1;
     while (s <= n - m) {
         int j = m - 1;
         while (j >= 0 && pattern[j] == text[s + j]) j--;
+        STAT_ADD(bm_comparisons, (m - 1 - j) + (j >= 0));
         if (j < 0) {
-            free(bpos); free(shift);
-            return s;
+            if (first < 0) first = s;
+            if (!count) break;
+            (*count)++;
+            s += shift[0];
+        } else {
+            int bad_shift = j - badchar[(unsigned char)text[s + j]];
+            int good_shift = shift[j + 1];
+            s += (bad_shift > good_shift) ? bad_shift : good_shift;
         }
-        int bad_shift = j - badchar[(unsigned char)text[s + j]];
-        int good_shift = shift[j + 1];
-        s += (bad_shift > good_shift) ? bad_shift : good_shift;
+        STAT_ADD(bm_shifts, 1);
     }
     free(bpos);
     free(shift);
-    return -1;
+    STAGE_END(search);
+    return first;
+}
+
+// Turbo-BM: помнит совпавший на прошлой попытке участок и перескакивает его,
+// поэтому даже при подсчёте всех вхождений сравнений не больше 2n
+int turbo_bm_search(const char* text, const char* pattern, long long* count) {
+    int m = strlen(pattern), n = strlen(text);
+    if (count) *count = 0;
+    if (m == 0 || n < m) return -1;
+
+    int badchar[ALPHABET_SIZE];
+    bad_char(pattern, m, badchar);
+
+    int* bpos = malloc((m + 1) * sizeof(int));
+    int* shift = malloc((m + 1) * sizeof(int));
+    good_suffix(shift, bpos, pattern, m);
+
+    STAGE_BEGIN(search);
+    // u - длина участка, совпавшего на прошлой попытке, last - прошлый сдвиг
+    int s = 0, first = -1, u = 0, last = m;
+    while (s <= n - m) {
+        int j = m - 1;
+        long long compared = 0;
+        while (j >= 0 && pattern[j] == text[s + j]) {
+            j--;
+            compared++;
+            // участок после сдвига уже сравнивался, пропускаем его
+            if (u != 0 && j == m - 1 - last)
+                j -= u;
+        }
+        STAT_ADD(bm_comparisons, compared + (j >= 0));
+        if (j < 0) {
+            if (first < 0) first = s;
+            if (!count) break;
+            (*count)++;
+            last = shift[0];
+            u = m - last;
+        } else {
+            int v = m - 1 - j;
+            int turbo_shift = u - v;
+            int bad_shift = j - badchar[(unsigned char)text[s + j]];
+            int good_shift = shift[j + 1];
+            last = turbo_shift > bad_shift ? turbo_shift : bad_shift;
+            if (good_shift > last) last = good_shift;
+            if (last == good_shift) {
+                u = m - last < v ? m - last : v;
+            } else {
+                if (turbo_shift < bad_shift && last < u + 1)
+                    last = u + 1;
+                u = 0;
+            }
+        }
+        s += last;
+        STAT_ADD(bm_shifts, 1);
+    }
+    free(bpos);
+    free(shift);
+    STAGE_END(search);
+    return first;
+}
+
+typedef int (*SearchFn)(const char*, const char*, long long*);
+
+// алгоритм поиска, выбирается -a
+SearchFn search_fn = boyer_moore_search;
+
+// ---- суффиксный массив текста порядка: строится один раз, запросы за O(m + log n) ----
+
+// индуцированная сортировка SA-IS: по отсортированным LMS-суффиксам
+// раскладываются L-суффиксы слева направо и S-суффиксы справа налево
+void sais_induce(const int *s, int n, const char *ls, const int *sum_l, const int *sum_s,
+                 int *buf, int upper, int *lms, int lms_count, int *sa) {
+    for (int i = 0; i < n; i++)
+        sa[i] = -1;
+    memcpy(buf, sum_s, (upper + 1) * sizeof(int));
+    for (int i = 0; i < lms_count; i++)
+        sa[buf[s[lms[i]]]++] = lms[i];
+    memcpy(buf, sum_l, (upper + 1) * sizeof(int));
+    sa[buf[s[n - 1]]++] = n - 1;
+    for (int i = 0; i < n; i++) {
+        int v = sa[i];
+        if (v >= 1 && !ls[v - 1])
+            sa[buf[s[v - 1]]++] = v - 1;
+    }
+    memcpy(buf, sum_l, (upper + 1) * sizeof(int));
+    for (int i = n - 1; i >= 0; i--) {
+        int v = sa[i];
+        if (v >= 1 && ls[v - 1])
+            sa[--buf[s[v - 1] + 1]] = v - 1;
+    }
+}
+
+// суффиксный массив строки s[0..n) над алфавитом [0, upper] за O(n)
+void sa_is(int *s, int n, int upper, int *sa) {
+    if (n == 0) return;
+    if (n == 1) { sa[0] = 0; return; }
+    if (n == 2) {
+        sa[0] = s[0] < s[1] ? 0 : 1;
+        sa[1] = 1 - sa[0];
+        return;
+    }
+
+    // ls[i] = 1 - суффикс i S-типа (меньше следующего)
+    char *ls = calloc(n, 1);
+    for (int i = n - 2; i >= 0; i--)
+        ls[i] = s[i] == s[i + 1] ? ls[i + 1] : s[i] < s[i + 1];
+
+    // начала корзин S- и L-суффиксов каждого символа
+    int *sum_l = calloc(upper + 2, sizeof(int));
+    int *sum_s = calloc(upper + 2, sizeof(int));
+    int *buf = malloc((upper + 2) * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        if (!ls[i])
+            sum_s[s[i]]++;
+        else
+            sum_l[s[i] + 1]++;
+    }
+    for (int i = 0; i <= upper; i++) {
+        sum_s[i] += sum_l[i];
+        if (i < upper)
+            sum_l[i + 1] += sum_s[i];
+    }
+
+    // LMS-позиции: S-суффикс сразу после L-суффикса
+    int *lms_map = malloc((n + 1) * sizeof(int));
+    int lms_count = 0;
+    for (int i = 0; i <= n; i++)
+        lms_map[i] = -1;
+    for (int i = 1; i < n; i++)
+        if (!ls[i - 1] && ls[i])
+            lms_map[i] = lms_count++;
+    int *lms = malloc((lms_count + 1) * sizeof(int));
+    for (int i = 1; i < n; i++)
+        if (lms_map[i] >= 0)
+            lms[lms_map[i]] = i;
+
+    sais_induce(s, n, ls, sum_l, sum_s, buf, upper, lms, lms_count, sa);
+
+    if (lms_count) {
+        // имена LMS-подстрок в порядке сортировки, одинаковые получают одно имя
+        int *sorted = malloc(lms_count * sizeof(int));
+        for (int i = 0, k = 0; i < n; i++)
+            if (lms_map[sa[i]] != -1)
+                sorted[k++] = sa[i];
+        int *rec_s = malloc(lms_count * sizeof(int));
+        int rec_upper = 0;
+        rec_s[lms_map[sorted[0]]] = 0;
+        for (int i = 1; i < lms_count; i++) {
+            int l = sorted[i - 1], r = sorted[i];
+            int end_l = lms_map[l] + 1 < lms_count ? lms[lms_map[l] + 1] : n;
+            int end_r = lms_map[r] + 1 < lms_count ? lms[lms_map[r] + 1] : n;
+            int same = end_l - l == end_r - r;
+            if (same) {
+                while (l < end_l && s[l] == s[r]) {
+                    l++;
+                    r++;
+                }
+                if (l == n || s[l] != s[r])
+                    same = 0;
+            }
+            if (!same)
+                rec_upper++;
+            rec_s[lms_map[sorted[i]]] = rec_upper;
+        }
+
+        // порядок LMS-суффиксов из суффиксного массива строки имён
+        int *rec_sa = malloc(lms_count * sizeof(int));
+        sa_is(rec_s, lms_count, rec_upper, rec_sa);
+        for (int i = 0; i < lms_count; i++)
+            sorted[i] = lms[rec_sa[i]];
+        sais_induce(s, n, ls, sum_l, sum_s, buf, upper, sorted, lms_count, sa);
+        free(rec_sa);
+        free(rec_s);
+        free(sorted);
+    }
+
+    free(ls);
+    free(sum_l);
+    free(sum_s);
+    free(buf);
+    free(lms_map);
+    free(lms);
+}
+
+// индекс текста: суффиксный массив и LCP середин двоичного поиска с его концами
+typedef struct {
+    const char *text;
+    int n;
+    int *sa;
+    int *llcp;  // llcp[M] = lcp(суффикс L, суффикс M)
+    int *rlcp;  // rlcp[M] = lcp(суффикс M, суффикс R)
+    // разреженная таблица минимумов sa по блокам из RMQ_BLOCK позиций:
+    // rmq[k * blocks + b] - минимум по блокам b .. b + 2^k - 1
+    int *rmq;
+    int blocks;
+    int levels;
+} SuffixIndex;
+
+// заполнение llcp/rlcp для всех отрезков (L, R) двоичного поиска,
+// возвращает lcp(суффикс L, суффикс R) как минимум lcp на отрезке; за границами - 0
+int suffix_index_fill(SuffixIndex *idx, const int *lcp, int l, int r) {
+    if (r - l <= 1)
+        return l >= 0 && r < idx->n ? lcp[r] : 0;
+    int mid = l + (r - l) / 2;
+    int a = suffix_index_fill(idx, lcp, l, mid);
+    int b = suffix_index_fill(idx, lcp, mid, r);
+    idx->llcp[mid] = a;
+    idx->rlcp[mid] = b;
+    return a < b ? a : b;
+}
+
+// разреженная таблица минимумов суффиксного массива по блокам
+void suffix_index_rmq(SuffixIndex *idx) {
+    int n = idx->n;
+    int blocks = idx->blocks = (n + RMQ_BLOCK - 1) / RMQ_BLOCK;
+    int levels = 1;
+    while ((1 << levels) <= blocks)
+        levels++;
+    idx->levels = levels;
+    idx->rmq = malloc((size_t)levels * (blocks > 0 ? blocks : 1) * sizeof(int));
+    for (int b = 0; b < blocks; b++) {
+        int lo = b * RMQ_BLOCK, hi = lo + RMQ_BLOCK < n ? lo + RMQ_BLOCK : n;
+        int best = idx->sa[lo];
+        for (int i = lo + 1; i < hi; i++)
+            if (idx->sa[i] < best)
+                best = idx->sa[i];
+        idx->rmq[b] = best;
+    }
+    for (int k = 1; k < levels; k++) {
+        int *prev = idx->rmq + (size_t)(k - 1) * blocks, *cur = prev + blocks;
+        for (int b = 0; b + (1 << k) <= blocks; b++) {
+            int a = prev[b], c = prev[b + (1 << (k - 1))];
+            cur[b] = a < c ? a : c;
+        }
+    }
+}
+
+// память индекса: суффиксный массив, два массива LCP и таблица минимумов
+long long suffix_index_bytes(const SuffixIndex *idx) {
+    return (long long)(idx->n + 1) * 3 * sizeof(int)
+           + (long long)idx->levels * idx->blocks * sizeof(int);
+}
+
+// построение индекса: SA-IS, затем LCP соседних суффиксов методом Касаи
+void suffix_index_build(SuffixIndex *idx, const char *text, int n) {
+    STAGE_BEGIN(index);
+    idx->text = text;
+    idx->n = n;
+    idx->sa = malloc((n + 1) * sizeof(int));
+    idx->llcp = malloc((n + 1) * sizeof(int));
+    idx->rlcp = malloc((n + 1) * sizeof(int));
+
+    // rlcp временно хранит строку, llcp - обратную перестановку
+    int *s = idx->rlcp;
+    for (int i = 0; i < n; i++)
+        s[i] = (unsigned char)text[i];
+    sa_is(s, n, ALPHABET_SIZE - 1, idx->sa);
+
+    int *rank = idx->llcp;
+    int *lcp = malloc((n + 1) * sizeof(int));
+    for (int i = 0; i < n; i++)
+        rank[idx->sa[i]] = i;
+    for (int i = 0, h = 0; i < n; i++) {
+        if (rank[i] == 0) {
+            lcp[0] = h = 0;
+            continue;
+        }
+        int j = idx->sa[rank[i] - 1];
+        while (i + h < n && j + h < n && text[i + h] == text[j + h])
+            h++;
+        lcp[rank[i]] = h;
+        if (h > 0)
+            h--;
+    }
+    suffix_index_fill(idx, lcp, -1, n);
+    free(lcp);
+    suffix_index_rmq(idx);
+    STAT_ADD(index_bytes, suffix_index_bytes(idx));
+    STAGE_END(index);
+}
+
+void suffix_index_free(SuffixIndex *idx) {
+    free(idx->sa);
+    free(idx->llcp);
+    free(idx->rlcp);
+    free(idx->rmq);
+}
+
+// наименьшая позиция суффикса среди sa[lo .. hi): неполные блоки по краям
+// просматриваются, полные - два перекрывающихся отрезка таблицы
+int suffix_index_min(const SuffixIndex *idx, int lo, int hi) {
+    int bl = lo / RMQ_BLOCK, bh = (hi - 1) / RMQ_BLOCK;
+    int best = INT_MAX;
+    int edge = bl == bh ? hi : (bl + 1) * RMQ_BLOCK;
+    for (int i = lo; i < edge; i++)
+        if (idx->sa[i] < best)
+            best = idx->sa[i];
+    if (bl == bh)
+        return best;
+    for (int i = bh * RMQ_BLOCK; i < hi; i++)
+        if (idx->sa[i] < best)
+            best = idx->sa[i];
+    int a = bl + 1, count = bh - a;
+    if (count > 0) {
+        int k = 31 - __builtin_clz(count);
+        const int *level = idx->rmq + (size_t)k * idx->blocks;
+        if (level[a] < best)
+            best = level[a];
+        if (level[bh - (1 << k)] < best)
+            best = level[bh - (1 << k)];
+    }
+    return best;
+}
+
+// граница отрезка суффиксов с префиксом pattern: первый суффикс не меньше
+// шаблона (upper = 0) или первый суффикс больше всех строк с этим префиксом (upper = 1).
+// Поиск Манбера-Майерса: уже совпавшие с концами отрезка символы не сравниваются повторно
+int suffix_index_bound(const SuffixIndex *idx, const char *pattern, int m, int upper) {
+    int l = -1, r = idx->n, ll = 0, lr = 0;
+    while (r - l > 1) {
+        int mid = l + (r - l) / 2;
+        int k;
+        if (ll >= lr) {
+            if (l >= 0 && idx->llcp[mid] > ll) { l = mid; continue; }
+            if (l >= 0 && idx->llcp[mid] < ll) { r = mid; lr = idx->llcp[mid]; continue; }
+            k = ll;
+        } else {
+            if (r < idx->n && idx->rlcp[mid] > lr) { r = mid; continue; }
+            if (r < idx->n && idx->rlcp[mid] < lr) { l = mid; ll = idx->rlcp[mid]; continue; }
+            k = lr;
+        }
+        const char *suf = idx->text + idx->sa[mid];
+        int rest = idx->n - idx->sa[mid];
+        while (k < m && k < rest && suf[k] == pattern[k])
+            k++;
+        STAT_ADD(bm_comparisons, k - (ll >= lr ? ll : lr) + 1);
+        // суффикс с префиксом pattern при upper считается меньше шаблона
+        int greater = k == m ? !upper : k < rest && (unsigned char)suf[k] > (unsigned char)pattern[k];
+        if (greater) {
+            r = mid;
+            lr = k;
+        } else {
+            l = mid;
+            ll = k;
+        }
+    }
+    return r;
+}
+
+// число вхождений шаблона; в first, если задан, - позиция первого вхождения или -1
+long long suffix_index_count(const SuffixIndex *idx, const char *pattern, int *first) {
+    int m = strlen(pattern);
+    if (first)
+        *first = -1;
+    if (m == 0 || idx->n < m) return 0;
+    STAGE_BEGIN(search);
+    int lo = suffix_index_bound(idx, pattern, m, 0);
+    int hi = suffix_index_bound(idx, pattern, m, 1);
+    if (first && hi > lo)
+        *first = suffix_index_min(idx, lo, hi);
+    STAGE_END(search);
+    return hi - lo;
 }
 
 // подсветка найденного совпадения
@@ -223,16 +1233,45 @@ void highlight_match(const char* text, int pos, const char* pattern) {
     printf("%s\n", text + pos + strlen(pattern));
 }
 
+// шаблоны поиска из командной строки, -1 - запросить интерактивно
+char **search_patterns = NULL;
+int search_pattern_count = -1;
+// подсчёт всех вхождений каждого шаблона (-n)
+int count_matches = 0;
+// поиск по суффиксному массиву вместо просмотра текста (-i)
+int use_index = 0;
+
+// поиск шаблона по индексу, если он построен, иначе выбранным алгоритмом
+int find_pattern(const char *text, const SuffixIndex *idx, const char *pattern, long long *count) {
+    if (!idx)
+        return search_fn(text, pattern, count);
+    int first;
+    long long matches = suffix_index_count(idx, pattern, &first);
+    if (count) *count = matches;
+    return first;
+}
+
+// дерево для результата (-T)
+typedef enum { TREE_RB, TREE_PERSISTENT, TREE_BPLUS } TreeKind;
+TreeKind tree_kind = TREE_RB;
+
 // включает в себя поиск и запись массива в дерево
 void process_and_search(int *result, int count) {
     RBTree tree;
     init_rbtree(&tree);
     TreeNode** inserted_nodes = malloc(count * sizeof(TreeNode*));
+    PTree ptree;
+    init_ptree(&ptree);
+    BPTree bptree;
+    init_bptree(&bptree);
 
-    char text[1024] = "";
+    // до 11 символов на число и пробел
+    char *text = malloc((size_t)count * 12 + 1);
     char buffer[32];
     int len = 0;
 
+    // время дерева включает построение текста для поиска
+    STAGE_BEGIN(tree);
     for (int i = 0; i < count; i++) {
         if (i > 0)
             text[len++] = ' ';
@@ -240,6 +1279,15 @@ void process_and_search(int *result, int count) {
         strcpy(&text[len], buffer);
         len += written;
 
+        if (tree_kind == TREE_PERSISTENT) {
+            insert_ptree(&ptree, result[i]);
+            continue;
+        }
+        if (tree_kind == TREE_BPLUS) {
+            insert_bptree(&bptree, result[i]);
+            continue;
+        }
+
         // Вставка с сохранением ссылки на узел
         TreeNode* node = (TreeNode*)malloc(sizeof(TreeNode));
         node->data = result[i];
@@ -267,36 +1315,132 @@ void process_and_search(int *result, int count) {
         inserted_nodes[i] = node;
     }
     text[len] = '\0';
+    STAGE_END(tree);
 
-    printf("Введите подстроку для поиска: ");
+    // индекс строится один раз на все шаблоны
+    SuffixIndex index, *idx = NULL;
+    if (use_index && search_pattern_count != 0) {
+        suffix_index_build(&index, text, len);
+        idx = &index;
+    }
 
-    // очистка буфера после предыдущего scanf
-    int ch;
-    while ((ch = getchar()) != '\n' && ch != EOF);
+    if (search_pattern_count < 0) {
+        STAGE_BEGIN(prompt);
+        printf("Введите подстроку для поиска: ");
 
-    char pattern[100];
-    fgets(pattern, sizeof(pattern), stdin);
+        // очистка буфера после предыдущего scanf
+        int ch;
+        while ((ch = getchar()) != '\n' && ch != EOF);
 
-    // удаление символа новой строки, если он остался
-    size_t pattern_len = strlen(pattern);
-    if (pattern_len > 0 && pattern[pattern_len - 1] == '\n')
-        pattern[pattern_len - 1] = '\0';
+        char pattern[100];
+        fgets(pattern, sizeof(pattern), stdin);
 
-    int pos = boyer_moore_search(text, pattern);
-    if (pos >= 0) {
-        printf("Найдено совпадение: \n");
-        highlight_match(text, pos, pattern);
-    } else {
-        printf("Совпадений не найдено.\n");
+        // удаление символа новой строки, если он остался
+        size_t pattern_len = strlen(pattern);
+        if (pattern_len > 0 && pattern[pattern_len - 1] == '\n')
+            pattern[pattern_len - 1] = '\0';
+        STAGE_END(prompt);
+
+        int pos = find_pattern(text, idx, pattern, NULL);
+        if (pos >= 0) {
+            printf("Найдено совпадение: \n");
+            highlight_match(text, pos, pattern);
+        } else {
+            printf("Совпадений не найдено.\n");
+        }
     }
 
-    printf("Результат в виде красно-чёрного дерева: \n");
-    for (int i = 0; i < count; i++) {
-        printf("%lld ", inserted_nodes[i]->data);
+    // шаблоны из командной строки: позиция первого вхождения или -1
+    for (int i = 0; i < search_pattern_count; i++) {
+        long long matches = 0;
+        int pos = find_pattern(text, idx, search_patterns[i], count_matches ? &matches : NULL);
+        char buf[64];
+        if (count_matches)
+            snprintf(buf, sizeof(buf), "%d (вхождений %lld)\n", pos, matches);
+        else
+            snprintf(buf, sizeof(buf), "%d\n", pos);
+        if (out.format == OUT_TEXT) {
+            out_str(&out, "Поиск '");
+            out_str(&out, search_patterns[i]);
+            out_str(&out, "': ");
+            out_str(&out, buf);
+        } else {
+            fprintf(stderr, "Поиск '%s': %s", search_patterns[i], buf);
+        }
+    }
+
+    // в двоичном режиме порядок уже записан, дерево выводим только текстом
+    if (out.format == OUT_TEXT) {
+        static const char *tree_titles[] = {
+            "Результат в виде красно-чёрного дерева: \n",
+            "Результат в виде персистентного красно-чёрного дерева: \n",
+            "Результат в виде B+-дерева: \n",
+        };
+        out_str(&out, tree_titles[tree_kind]);
+        for (int i = 0; i < count; i++) {
+            // узлы персистентного дерева копируются, B+-дерево хранит только ключи,
+            // поэтому порядок вставки берём из результата
+            out_int(&out, tree_kind == TREE_RB ? inserted_nodes[i]->data : result[i]);
+        }
+        out_end(&out);
     }
-    printf("\n");
 
+    if (idx)
+        suffix_index_free(idx);
+    free(text);
     free(inserted_nodes);
+    free_ptree(&ptree);
+    free_bptree(&bptree);
+}
+
+// чтение рёбер из файла в переиспользуемый массив, который расширяется по мере заполнения
+// возвращает число рёбер или -1, если файл не открылся
+int read_edges(const char *filename, Edge **edges_buf, int *capacity) {
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        perror(filename);
+        return -1;
+    }
+
+    if (*capacity == 0) {
+        *capacity = INITIAL_EDGES;
+        *edges_buf = malloc(*capacity * sizeof(Edge));
+    }
+    Edge *edges = *edges_buf;
+    char line[256];
+    int line_number = 0;
+    int edge_count = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        line_number++;
+
+        // пропускаем пустые строки
+        if (line[0] == '\n' || line[0] == '\0') continue;
+
+        int u, v;
+        char extra;
+
+        int count = sscanf(line, "%d %d %c", &u, &v, &extra);
+        if (count < 2 || u < 0 || v < 0) {
+            fprintf(stderr, "Ошибка в строке %d: '%s'\n", line_number, line);
+            STAT_ADD(lines_rejected, 1);
+            continue; // пропускаем некорректную строку
+        }
+
+        if (edge_count == *capacity) {
+            *capacity *= 2;
+            edges = realloc(edges, *capacity * sizeof(Edge));
+            *edges_buf = edges;
+        }
+
+        edges[edge_count].from = u;
+        edges[edge_count].to = v;
+        edge_count++;
+        STAT_ADD(edges_parsed, 1);
+    }
+    fclose(f);
+
+    return edge_count;
 }
 
 // подсчёт количества вершин
@@ -311,8 +1455,64 @@ int find_vertex_count(Edge *edges, int edge_count) {
     return max + 1;
 }
 
+// выделение памяти для матрицы смежности и заполнение графа
+int **build_adj(Edge *edges, int edge_count, int vertex_count) {
+    int **adj = malloc(vertex_count * sizeof(int *));
+    for (int i = 0; i < vertex_count; ++i)
+        adj[i] = calloc(vertex_count, sizeof(int));
+
+    for (int i = 0; i < edge_count; ++i) {
+        int u = edges[i].from;
+        int v = edges[i].to;
+        adj[u][v] = 1;
+    }
+    return adj;
+}
+
+// освобождение матрицы смежности
+void free_adj(int **adj, int vertex_count) {
+    for (int i = 0; i < vertex_count; ++i)
+        free(adj[i]);
+    free(adj);
+}
+
+// буферы, переиспользуемые между заданиями пакетного режима
+typedef struct {
+    Edge *edges;
+    int edge_capacity;
+    int **adj;
+    int *cells;
+    int vertex_capacity;
+} Workspace;
+
+// матрица смежности в общем блоке рабочей области
+int **workspace_adj(Workspace *ws, int edge_count, int vertex_count) {
+    if (vertex_count > ws->vertex_capacity) {
+        free(ws->adj);
+        free(ws->cells);
+        ws->adj = malloc(vertex_count * sizeof(int *));
+        ws->cells = malloc((size_t)vertex_count * vertex_count * sizeof(int));
+        ws->vertex_capacity = vertex_count;
+    }
+    memset(ws->cells, 0, (size_t)vertex_count * vertex_count * sizeof(int));
+    for (int i = 0; i < vertex_count; ++i)
+        ws->adj[i] = ws->cells + (size_t)i * vertex_count;
+
+    for (int i = 0; i < edge_count; ++i)
+        ws->adj[ws->edges[i].from][ws->edges[i].to] = 1;
+    return ws->adj;
+}
+
+void free_workspace(Workspace *ws) {
+    free(ws->edges);
+    free(ws->adj);
+    free(ws->cells);
+}
+
 // топологическая сортировка методом Кана
-void top_sort_kahn(int **adj, int vertex_count) {
+// возвращает порядок вершин или NULL, если граф содержит цикл
+int *top_sort_kahn(int **adj, int vertex_count) {
+    STAGE_BEGIN(kahn);
     int *in_degree = calloc(vertex_count, sizeof(int));
     int *queue = malloc(vertex_count * sizeof(int));
     int *result = malloc(vertex_count * sizeof(int));
@@ -326,6 +1526,7 @@ void top_sort_kahn(int **adj, int vertex_count) {
     for (int i = 0; i < vertex_count; ++i)
         if (in_degree[i] == 0)
             queue[rear++] = i;
+    STAT_ADD(queue_pushes, rear);
 
     while (front < rear) {
         int u = queue[front++];
@@ -334,25 +1535,33 @@ void top_sort_kahn(int **adj, int vertex_count) {
         for (int v = 0; v < vertex_count; ++v) {
             if (adj[u][v]) {
                 in_degree[v]--;
-                if (in_degree[v] == 0)
+                if (in_degree[v] == 0) {
                     queue[rear++] = v;
+                    STAT_ADD(queue_pushes, 1);
+                }
             }
         }
     }
+    STAGE_END(kahn);
 
+    STAGE_BEGIN(output);
     if (count != vertex_count) {
-        printf("Граф содержит цикл\n");
+        out_cycle(&out);
     } else {
-        printf("Результат (Кан): ");
+        out_begin(&out, "Результат (Кан): ", count);
         for (int i = 0; i < count; ++i)
-            printf("%d ", result[i]);
-        printf("\n");
-        process_and_search(result, count);
+            out_int(&out, result[i]);
+        out_end(&out);
     }
+    STAGE_END(output);
 
     free(in_degree);
     free(queue);
-    free(result);
+    if (count != vertex_count) {
+        free(result);
+        return NULL;
+    }
+    return result;
 }
 
 // топологическая сортировка методом Тарьяна
@@ -360,11 +1569,13 @@ int has_cycle = 0;
 
 void dfs_tarjan(int **adj, int u, int *visited, int *stack, int *top, int vertex_count) {
     if (has_cycle) return;
+    STAT_DFS_ENTER();
     visited[u] = 1;
     for (int v = 0; v < vertex_count; ++v) {
         if (!adj[u][v]) continue;
         if (visited[v] == 1) {
             has_cycle = 1;
+            STAT_DFS_LEAVE();
             return;
         } else if (visited[v] == 0) {
             dfs_tarjan(adj, v, visited, stack, top, vertex_count);
@@ -372,9 +1583,12 @@ void dfs_tarjan(int **adj, int u, int *visited, int *stack, int *top, int vertex
     }
     visited[u] = 2;
     stack[(*top)++] = u;
+    STAT_DFS_LEAVE();
 }
 
-void top_sort_tarjan(int **adj, int vertex_count) {
+// возвращает порядок вершин или NULL, если граф содержит цикл
+int *top_sort_tarjan(int **adj, int vertex_count) {
+    STAGE_BEGIN(tarjan);
     int *visited = calloc(vertex_count, sizeof(int));
     int *stack = malloc(vertex_count * sizeof(int));
     int top = 0;
@@ -383,106 +1597,252 @@ void top_sort_tarjan(int **adj, int vertex_count) {
     for (int i = 0; i < vertex_count; ++i)
         if (!visited[i])
             dfs_tarjan(adj, i, visited, stack, &top, vertex_count);
+    STAGE_END(tarjan);
 
+    STAGE_BEGIN(output);
+    int* result = NULL;
     if (has_cycle) {
-        printf("Граф содержит цикл\n");
+        out_cycle(&out);
     } else {
-        int* result = malloc(top * sizeof(int));
-        printf("Результат (Тарьян): ");
+        result = malloc(top * sizeof(int));
+        out_begin(&out, "Результат (Тарьян): ", vertex_count);
         for (int i = 0; i < top; ++i) {
             result[i] = stack[top - 1 - i]; // разворачиваем стек
-            printf("%d ", result[i]);
+            out_int(&out, result[i]);
         }
-        printf("\n");
-        process_and_search(result, top);
-        free(result);
+        out_end(&out);
     }
+    STAGE_END(output);
 
     free(visited);
     free(stack);
+    return result;
 }
 
-int main() {
-    char filename[100];
-    int method = 0;
+// одно задание: чтение файла, построение графа и сортировка
+int run_job(const char *filename, int method, Workspace *ws) {
+    STAGE_BEGIN(parse);
+    int edge_count = read_edges(filename, &ws->edges, &ws->edge_capacity);
+    STAGE_END(parse);
+    if (edge_count < 0)
+        return 1;
 
-    printf("Введите имя файла: ");
-    scanf("%s", filename);
+    if (edge_count == 0) {
+        fprintf(stderr, "Файл %s не содержит корректных рёбер\n", filename);
+        return 1;
+    }
 
-    // ввод метода сортировки
-    while (1) {
-        printf("Выберите метод сортировки:\n1 - Кан\n2 - Тарьян\n> ");
-        if (scanf("%d", &method) != 1 || (method != 1 && method != 2)) {
-            printf("Некорректный ввод. Пожалуйста, введите 1 или 2.\n");
-            while (getchar() != '\n'); // очистка ввода
-        } else break;
+    STAGE_BEGIN(build);
+    int vertex_count = find_vertex_count(ws->edges, edge_count);
+    int **adj = workspace_adj(ws, edge_count, vertex_count);
+    STAGE_END(build);
+
+    // запуск нужного метода
+    int *result;
+    if (method == 1)
+        result = top_sort_kahn(adj, vertex_count);
+    else
+        result = top_sort_tarjan(adj, vertex_count);
+
+    // поиск и запись в дерево
+    if (result) {
+        process_and_search(result, vertex_count);
+        free(result);
     }
+    return 0;
+}
 
-    FILE *f = fopen(filename, "r");
+// пакетный режим: список файлов графов, по одному на строку
+int run_batch(const char *manifest, int method, Workspace *ws) {
+    FILE *f = fopen(manifest, "r");
     if (!f) {
-        perror("Ошибка при открытии файла");
+        perror(manifest);
         return 1;
     }
 
-    Edge edges[MAX_EDGES];
-    int edge_count = 0;
-    char line[256];
-    int line_number = 0;
-
+    char line[4096];
+    int failed = 0;
     while (fgets(line, sizeof(line), f)) {
-        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        // пропускаем пустые строки и комментарии
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        out_str(&out, "# ");
+        out_str(&out, line);
+        out_str(&out, "\n");
+        if (run_job(line, method, ws) != 0) {
+            failed++;
+            if (out.format == OUT_BINARY)
+                out_int(&out, -2); // задание не выполнено
+        }
+    }
+    fclose(f);
+    out_flush(&out);
+    return failed ? 1 : 0;
+}
 
-        // пропускаем пустые строки
-        if (line[0] == '\n' || line[0] == '\0') continue;
+// разбор названия метода: 1 - Кан, 2 - Тарьян, 0 - ошибка
+int parse_method(const char *s) {
+    if (strcmp(s, "1") == 0 || strcmp(s, "kahn") == 0) return 1;
+    if (strcmp(s, "2") == 0 || strcmp(s, "tarjan") == 0) return 2;
+    return 0;
+}
 
-        int u, v;
-        char extra;
-        int count = sscanf(line, "%d %d %c", &u, &v, &extra);
-        if (count < 2 || u < 0 || v < 0) {
-            printf("Ошибка в строке %d: '%s'\n", line_number, line);
-            continue; // пропускаем некорректную строку
-        }
+// конец ввода во время вопросов: ответа уже не будет
+void input_ended(void) {
+    fprintf(stderr, "Ввод закончился, параметры не заданы\n");
+    exit(1);
+}
+
+// очистка ввода до конца строки после некорректного ответа
+void skip_input_line(void) {
+    int ch;
+    while ((ch = getchar()) != '\n')
+        if (ch == EOF)
+            input_ended();
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "Использование: %s [-f файл | -b список] [-m kahn|tarjan] [-p шаблон]... [-a bm|turbo] [-n] [-i]\n"
+            "       [-T rb|persistent|bplus] [-o text|binary] [-w файл]\n"
+            "  -f файл    файл с рёбрами графа\n"
+            "  -b список  пакетный режим: файл со списком графов, по одному на строку\n"
+            "  -m метод   kahn (1) или tarjan (2)\n"
+            "  -p шаблон  подстрока для поиска Бойера-Мура, можно указать несколько раз\n"
+            "  -a алг     bm - Бойер-Мур, turbo - Turbo-BM (не больше 2n сравнений)\n"
+            "  -n         считать все вхождения шаблона, а не только первое\n"
+            "  -T дерево  rb - красно-чёрное, persistent - персистентное с копированием пути,\n"
+            "             bplus - B+-дерево с узлами в строку кэша\n"
+            "  -i         искать по суффиксному массиву текста (строится один раз на все шаблоны)\n"
+            "  -o формат  text или binary (int32 little-endian)\n"
+            "  -w файл    файл для результата (по умолчанию stdout)\n"
+            "Без аргументов параметры запрашиваются интерактивно.\n",
+            name);
+}
 
-        if (edge_count >= MAX_EDGES) {
-            printf("Превышено допустимое количество рёбер (%d)\n", MAX_EDGES);
+int main(int argc, char **argv) {
+    char filename_buf[100];
+    const char *filename = NULL, *manifest = NULL, *out_name = NULL;
+    int method = 0, format = 0;
+    int opt;
+
+    search_patterns = malloc(argc * sizeof(char *));
+    while ((opt = getopt(argc, argv, "f:b:m:p:a:niT:o:w:h")) != -1) {
+        switch (opt) {
+        case 'f': filename = optarg; break;
+        case 'p':
+            if (search_pattern_count < 0) search_pattern_count = 0;
+            search_patterns[search_pattern_count++] = optarg;
+            break;
+        case 'b': manifest = optarg; break;
+        case 'a':
+            if (strcmp(optarg, "bm") == 0) search_fn = boyer_moore_search;
+            else if (strcmp(optarg, "turbo") == 0) search_fn = turbo_bm_search;
+            else {
+                fprintf(stderr, "Неизвестный алгоритм поиска: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'n': count_matches = 1; break;
+        case 'i': use_index = 1; break;
+        case 'T':
+            if (strcmp(optarg, "rb") == 0) tree_kind = TREE_RB;
+            else if (strcmp(optarg, "persistent") == 0) tree_kind = TREE_PERSISTENT;
+            else if (strcmp(optarg, "bplus") == 0) tree_kind = TREE_BPLUS;
+            else {
+                fprintf(stderr, "Неизвестный вид дерева: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'm':
+            method = parse_method(optarg);
+            if (!method) {
+                fprintf(stderr, "Неизвестный метод: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'o':
+            if (strcmp(optarg, "text") == 0) format = 1;
+            else if (strcmp(optarg, "binary") == 0) format = 2;
+            else {
+                fprintf(stderr, "Неизвестный формат: %s\n", optarg);
+                return 1;
+            }
             break;
+        case 'w': out_name = optarg; break;
+        default:
+            usage(argv[0]);
+            return 1;
         }
-
-        edges[edge_count].from = u;
-        edges[edge_count].to = v;
-        edge_count++;
     }
-    fclose(f);
-
-    if (edge_count == 0) {
-        printf("Файл не содержит корректных рёбер. Завершение программы.\n");
-        return 1;
+    int interactive = argc == 1;
+    if (!interactive && search_pattern_count < 0)
+        search_pattern_count = 0;
+
+    if (!filename && !manifest) {
+        printf("Введите имя файла: ");
+        if (scanf("%99s", filename_buf) != 1)
+            input_ended();
+        filename = filename_buf;
     }
 
-    int vertex_count = find_vertex_count(edges, edge_count);
+    // ввод метода сортировки
+    while (!method) {
+        printf("Выберите метод сортировки:\n1 - Кан\n2 - Тарьян\n> ");
+        if (scanf("%d", &method) != 1 || (method != 1 && method != 2)) {
+            printf("Некорректный ввод. Пожалуйста, введите 1 или 2.\n");
+            skip_input_line();
+            method = 0;
+        }
+    }
 
-    // выделение памяти для матрицы смежности
-    int **adj = malloc(vertex_count * sizeof(int *));
-    for (int i = 0; i < vertex_count; ++i)
-        adj[i] = calloc(vertex_count, sizeof(int));
+    // ввод формата вывода
+    while (interactive && !format) {
+        printf("Выберите формат вывода:\n1 - Текстовый\n2 - Двоичный (int32 little-endian)\n> ");
+        if (scanf("%d", &format) != 1 || (format != 1 && format != 2)) {
+            printf("Некорректный ввод. Пожалуйста, введите 1 или 2.\n");
+            skip_input_line();
+            format = 0;
+        }
+    }
 
-    // заполнение графа
-    for (int i = 0; i < edge_count; ++i) {
-        int u = edges[i].from;
-        int v = edges[i].to;
-        adj[u][v] = 1;
+    char out_name_buf[100];
+    if (interactive && format == 2) {
+        printf("Введите имя файла для вывода: ");
+        if (scanf("%99s", out_name_buf) != 1)
+            input_ended();
+        out_name = out_name_buf;
     }
 
-    // запуск нужного метода
-    if (method == 1)
-        top_sort_kahn(adj, vertex_count);
-    else
-        top_sort_tarjan(adj, vertex_count);
+    if (out_name) {
+        out.fd = open(out_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out.fd < 0) {
+            perror("Ошибка при открытии файла вывода");
+            return 1;
+        }
+    }
+    if (format == 2)
+        out.format = OUT_BINARY;
+
+    STAGE_BEGIN(total);
+    Workspace ws = {0};
+    int status;
+    if (manifest) {
+        out.framed = 1;
+        status = run_batch(manifest, method, &ws);
+    } else {
+        status = run_job(filename, method, &ws);
+    }
 
     // очистка памяти
-    for (int i = 0; i < vertex_count; ++i)
-        free(adj[i]);
-    free(adj);
+    free_workspace(&ws);
+    free(search_patterns);
+    if (out.fd != 1)
+        close(out.fd);
 
-    return 0;
-}
\ No newline at end of file
+    STAGE_END(total);
+    stats_report();
+
+    return status;
+}